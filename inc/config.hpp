@@ -0,0 +1,202 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// .yml to struct
+typedef struct resolution_t {
+    int width;
+    int height;
+    float aspectRatio;
+} resolution_t;
+
+typedef struct centerHud_t {
+    bool enable;
+} textures_t;
+
+typedef struct fix_t {
+    centerHud_t centerHud;
+} fix_t;
+
+typedef struct timeline_t {
+    bool csv;
+
+    bool operator==(const timeline_t&) const = default;
+} timeline_t;
+
+typedef struct frametime_t {
+    bool enable;
+
+    bool operator==(const frametime_t&) const = default;
+} frametime_t;
+
+typedef struct frameLimiter_t {
+    bool enable;
+    int fps;
+    std::string mode;       // "pacing" or "latency"
+
+    bool operator==(const frameLimiter_t&) const = default;
+} frameLimiter_t;
+
+typedef struct renderScale_t {
+    bool enable;
+    float scale;            // Fraction of the resolution the 3D scene is rendered at
+    bool dynamic;           // Follow the frame time instead of a fixed scale
+    int targetFps;          // Frame rate dynamic scaling aims for
+
+    bool operator==(const renderScale_t&) const = default;
+} renderScale_t;
+
+typedef struct retargetRule_t {
+    int value;              // 1280 or 1920
+    std::string kind;       // "int", "float", "double" or "any"
+    std::string use;        // "load", "store", "compare", "arithmetic", "push", "other" or "any"
+    uint32_t rva;           // Only the instruction at this RVA, 0 for every match
+    std::string to;         // A number or the name of a constant, e.g. "width"
+
+    bool operator==(const retargetRule_t&) const = default;
+} retargetRule_t;
+
+typedef struct retarget_t {
+    bool csv;               // Write every reference found to ValkyriaChroniclesFix.constants.csv
+    std::vector<retargetRule_t> rules;
+
+    bool operator==(const retarget_t&) const = default;
+} retarget_t;
+
+typedef struct overlay_t {
+    bool enable;
+
+    bool operator==(const overlay_t&) const = default;
+} overlay_t;
+
+typedef struct log_t {
+    std::string level;
+} log_t;
+
+typedef struct yml_t {
+    std::string name;
+    bool masterEnable;
+    resolution_t resolution;
+    fix_t fix;
+    timeline_t timeline;
+    frametime_t frametime;
+    frameLimiter_t frameLimiter;
+    renderScale_t renderScale;
+    retarget_t retarget;
+    overlay_t overlay;
+    log_t log;
+} yml_t;
+
+/**
+ * @brief Every value the fixes derive from the resolution, computed once after loading
+ * @details Hot paths only ever read from here. Cache line aligned so the game
+ *      touches a single line for all of them. The scalers the game itself keeps,
+ *      listed in the notes at the top of dllmain.cpp, are derived from the width
+ *      the game renders for.
+ */
+typedef struct alignas(64) constants_t {
+    float width;
+    float height;
+    float defaultWidth;     // height * 16 / 9, the width the HUD is laid out for
+    float pixelScaler;      // 77 * width / defaultWidth
+    float centerOffset;     // (width - defaultWidth) / 2, centers the 16:9 HUD
+    float minimapLeft;      // Left X of the minimap overlay
+    float minimapRight;     // Right X of the minimap overlay
+    float uiScale;          // Valkyria.exe+13542E4 = width
+    float viewportScale;    // Valkyria.exe+13542F0 = width / 2
+    float uiOffset;         // Valkyria.exe+1354310 = (width - 1280) / 2
+    float uiScaleRatio;     // Valkyria.exe+1354318 = width / 1280
+} constants_t;
+
+/**
+ * @brief Everything hooks and render callbacks read at runtime, published through a `Snapshot`
+ * @details Plain data only, the strings and everything else only needed while loading
+ *      stay in `yml_t`. The constants come first and fill the first cache line on
+ *      their own, which is all the game's hooks ever read.
+ */
+typedef struct alignas(64) hot_t {
+    constants_t constants;
+    bool frametime;
+    bool frameLimiter;
+    bool latency;           // frameLimiter.mode is "latency"
+    bool renderScale;
+    bool dynamicScale;
+    int fps;
+    float scale;
+    int targetFps;
+    bool overlay;
+} hot_t;
+
+namespace Config
+{
+    /**
+     * @brief Computes every derived value of a resolution
+     *
+     * @param resolution Resolution in use, width and height must not be 0
+     * @return constants_t
+     */
+    constants_t computeConstants(const resolution_t& resolution);
+
+    /**
+     * @brief Builds the runtime snapshot of a configuration
+     *
+     * @param yml Configuration, with the resolution already resolved
+     * @param constants From `computeConstants`
+     * @return hot_t
+     */
+    hot_t makeHot(const yml_t& yml, const constants_t& constants);
+
+    /**
+     * @brief Where the configuration was loaded from
+     */
+    enum class source_t {
+        Cache,
+        Yaml
+    };
+
+    /**
+     * @brief Loads the configuration, skipping yaml-cpp when possible
+     * @details Loads `yml` from a compact binary copy of the configuration at
+     *      `cachePath` if it was written for the current size and last write time
+     *      of the file at `ymlPath`. Otherwise the yml file is parsed with yaml-cpp
+     *      and the binary copy is rewritten for the next launch. Only values read
+     *      from the file are stored, values derived from them such as
+     *      `resolution.aspectRatio` are left to the caller.
+     *      Must not be called from `DllMain`, yaml-cpp allocates heavily and the
+     *      loader lock would stall the game's own DLL loading.
+     *
+     * @param ymlPath Path of the yml file
+     * @param cachePath Path of the binary copy, nullptr to always parse the yml
+     *      file and leave no copy behind
+     * @param yml Receives the configuration
+     * @return Where the configuration was loaded from
+     * @throws YAML::Exception if the yml file has to be parsed and can not be
+     */
+    source_t load(const char* ymlPath, const char* cachePath, yml_t* yml);
+}
@@ -0,0 +1,90 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <windows.h>
+#include <atomic>
+#include <cstdint>
+#include <intrin.h>
+
+namespace Events
+{
+    /**
+     * @brief Number of events kept, older ones are overwritten
+     */
+    constexpr uint32_t ringSize = 4096;
+    static_assert((ringSize & (ringSize - 1)) == 0, "ringSize must be a power of two");
+
+    /**
+     * @brief One fixed format event, formatted to text only by `dump`
+     */
+    typedef struct event_t {
+        uint64_t tsc;           // __rdtsc() when recorded
+        const char* name;       // String literal
+        uint32_t thread;
+        uint32_t arg;
+    } event_t;
+
+    extern event_t ring[ringSize];
+    extern std::atomic<uint32_t> head;
+
+    /**
+     * @brief Record an event from a hot path
+     * @details Costs an `__rdtsc`, one atomic increment and a 24 byte store, nothing
+     *      is formatted, allocated or locked so it is safe inside hook bodies.
+     *
+     * @param name Name of the event, must be a string literal
+     * @param arg Any value worth keeping, e.g. a register
+     */
+    inline void record(const char* name, uint32_t arg = 0) {
+        uint32_t index = head.fetch_add(1, std::memory_order_relaxed) & (ringSize - 1);
+        ring[index] = { __rdtsc(), name, (uint32_t)GetCurrentThreadId(), arg };
+    }
+
+    /**
+     * @brief Write every event still in the ring to a text file, oldest first
+     * @details Formats into a stack buffer and writes with `WriteFile`, the heap is
+     *      never touched so this is safe to call from `DllMain` while the process
+     *      exits. Does nothing if no event was recorded.
+     *
+     * @param path Path of the file, overwritten if it exists
+     * @return true if the file was written
+     */
+    bool dump(const char* path);
+}
+
+#ifdef RECORD_EVENTS
+
+/**
+ * Records an event from a hook body. Compiled out entirely unless the
+ * `RECORD_EVENTS` CMake option is on.
+ */
+#define RECORD_EVENT(NAME, ARG) Events::record(NAME, ARG)
+
+#else
+
+#define RECORD_EVENT(NAME, ARG)
+
+#endif
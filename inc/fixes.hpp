@@ -0,0 +1,68 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "config.hpp"
+#include "hook.hpp"
+
+/**
+ * @file fixes.hpp
+ * @brief What every hooking fix in dllmain.cpp writes
+ *
+ * Each fix is a list of `Hook::store_t`, encoded into its stub and performed by
+ * its fallback with `Hook::apply`, so both always do the same. Shared with the
+ * benchmark, which replays recorded hook calls through these lists at other
+ * resolutions. Why each value is what it is, is documented with the fix.
+ */
+
+namespace Fixes
+{
+    /**
+     * @brief `centerUiIconsFix()`, 1280.0f to esp + 0xC
+     */
+    std::vector<Hook::store_t> centerUiIcons();
+
+    /**
+     * @brief `minimapOverlayFix()`, both X values of the minimap overlay to eax + 0x90 and + 0x98
+     *
+     * @param constants Constants of the resolution in use
+     */
+    std::vector<Hook::store_t> minimapOverlay(const constants_t& constants);
+
+    /**
+     * @brief `textboxFix()`, 1280.0f to ebp - 0x8
+     */
+    std::vector<Hook::store_t> textbox();
+
+    /**
+     * @brief `uiScalingFix()`, 2.0f to the UI scaler the game keeps
+     *
+     * @param uiScaler Address of the scaler, from the `fld` at the hook
+     */
+    std::vector<Hook::store_t> uiScaling(uintptr_t uiScaler);
+}
@@ -0,0 +1,77 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <windows.h>
+#include <string>
+
+namespace FrameStats
+{
+    /**
+     * @brief Number of frames kept, about 2 minutes at 144 fps
+     */
+    constexpr size_t ringSize = 16384;
+
+    /**
+     * @brief Summary of the frames currently in the ring
+     * @details Lows are the frame rate at the 99th and 99.9th percentile frame time.
+     */
+    typedef struct stats_t {
+        size_t frames;
+        double averageMs;
+        double varianceMs;      // Variance of the frame time in ms^2
+        double averageFps;
+        double low1Fps;
+        double low01Fps;
+    } stats_t;
+
+    /**
+     * @brief Timestamp a presented frame, one `QueryPerformanceCounter` and a store
+     */
+    void frame();
+
+    /**
+     * @brief Compute the summary of the recorded frames
+     *
+     * @return stats_t, all zero if fewer than two frames were recorded
+     */
+    stats_t compute();
+
+    /**
+     * @brief One line summary, e.g. "1234 frames avg 6.94 ms (144.1 fps) var 0.31 ms^2 1% low 98.2 fps 0.1% low 61.0 fps"
+     *
+     * @return std::string
+     */
+    std::string summary();
+
+    /**
+     * @brief Write every recorded frame time to a CSV file
+     * @details Columns are `frame,frametime_ms`, oldest frame first.
+     *
+     * @param path Path of the CSV file, overwritten if it exists
+     * @return true on success
+     */
+    bool writeCsv(const char* path);
+}
@@ -0,0 +1,222 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+#include <vector>
+
+#include "Zydis/Zydis.h"
+#include "safetyhook.hpp"
+
+namespace Hook
+{
+    /**
+     * @brief Addresses `Mid` can hook, later ones can not be hooked
+     */
+    constexpr size_t maxSites = 16;
+
+    /**
+     * @brief Handlers per address, every site then fits on one cache line
+     */
+    constexpr size_t maxHandlers = 8;
+
+    /**
+     * @brief One handler of a mid hook shared by every handler at the same address
+     * @details The first handler at an address installs a single mid hook there. Its
+     *      callback walks the site's contiguous array of handlers and runs the ones
+     *      whose bit is set in the site's enable word, in the order they were created.
+     *      N fixes at one address then cost one context save and restore instead of N.
+     *      Switching a handler is an atomic bit flip, nothing is frozen or rewritten,
+     *      and with every bit clear the hook only saves and restores the context.
+     *      Slots are never freed, a `reset` handler keeps its slot for the next `create`
+     *      at the same address.
+     *
+     * @code
+     * static Hook::Mid hook;
+     * hook.create(address, [](SafetyHookContext& ctx) {
+     *     *((float*)(ctx.ebp - 0x8)) = 1280.0f;
+     * });
+     * @endcode
+     */
+    class Mid {
+    public:
+        /**
+         * @brief Add the handler to the site at `target`, installing the mid hook if it is the first
+         *
+         * @param target Address of the instruction to run before
+         * @param handler Runs with the registers as they are at `target`
+         * @return false if the mid hook could not be installed or `maxSites` or `maxHandlers` is reached
+         */
+        bool create(void* target, safetyhook::MidHookFn handler);
+
+        /**
+         * @brief Stop running the handler, the mid hook stays for the other handlers of the site
+         */
+        void reset();
+
+        /**
+         * @brief Turn the handler on or off, safe with the game running
+         *
+         * @param enable true to turn on
+         * @return true if there is a handler and it was switched
+         */
+        bool setEnabled(bool enable);
+
+        /**
+         * @brief true once created
+         */
+        explicit operator bool() const { return site != maxSites; }
+
+    private:
+        size_t site = maxSites;     // Index into the site table
+        size_t slot = 0;            // Bit in the site's enable word
+        void* target = nullptr;     // Kept across `reset` so the slot can be reused
+    };
+
+    /**
+     * @brief A 32 bit constant stored to `[base + displacement]`
+     * @details With `base` set to `ZYDIS_REGISTER_NONE` the displacement is an
+     *      absolute address. Registers are read as they are at the hooked address.
+     */
+    typedef struct store_t {
+        ZydisRegister base;
+        int32_t displacement;
+        uint32_t value;
+    } store_t;
+
+    /**
+     * @brief Address a store writes to, with the registers as a mid hook sees them
+     *
+     * @param store Store to locate
+     * @param ctx Registers at the hooked address
+     * @return uintptr_t
+     */
+    inline uintptr_t address(const store_t& store, const SafetyHookContext& ctx) {
+        uintptr_t base = 0;
+        switch (store.base) {
+        case ZYDIS_REGISTER_EAX:
+            base = ctx.eax;
+            break;
+        case ZYDIS_REGISTER_EBX:
+            base = ctx.ebx;
+            break;
+        case ZYDIS_REGISTER_ECX:
+            base = ctx.ecx;
+            break;
+        case ZYDIS_REGISTER_EDX:
+            base = ctx.edx;
+            break;
+        case ZYDIS_REGISTER_ESI:
+            base = ctx.esi;
+            break;
+        case ZYDIS_REGISTER_EDI:
+            base = ctx.edi;
+            break;
+        case ZYDIS_REGISTER_EBP:
+            base = ctx.ebp;
+            break;
+        case ZYDIS_REGISTER_ESP:
+            base = ctx.esp;
+            break;
+        default:
+            // ZYDIS_REGISTER_NONE, the displacement is the address
+            break;
+        }
+        return base + (uintptr_t)(intptr_t)store.displacement;
+    }
+
+    /**
+     * @brief Perform stores the way the stub of a `Store` does, meant for its fallback
+     *
+     * @param stores Stores to perform, in order
+     * @param ctx Registers at the hooked address
+     */
+    inline void apply(const std::vector<store_t>& stores, SafetyHookContext& ctx) {
+        for (const store_t& store : stores) {
+            *(uint32_t*)address(store, ctx) = store.value;
+        }
+    }
+
+    /**
+     * @brief Hook that only stores constants before the hooked instruction runs
+     * @details Instead of a mid hook, which saves and restores every register around
+     *      a C++ callback, the stores are encoded with Zydis into a tiny stub:
+     *
+     *      mov dword ptr [base + displacement], value    ; for every store
+     *      jmp trampoline                                ; relocated original code
+     *
+     *      and the target is inline hooked to jump to it, so a call costs a couple of
+     *      jumps and the stores. When the stub can not be encoded or the target can not
+     *      be inline hooked, `fallback` is installed as a `Mid` handler instead, sharing
+     *      one mid hook with any other handler at the target. It must do the same stores.
+     *      Builds with `PROFILE_HOOKS` or `TRACE_HOOKS` always use the fallback.
+     *
+     * @code
+     * static std::vector<Hook::store_t> stores = { { ZYDIS_REGISTER_ESP, 0xC, std::bit_cast<uint32_t>(1280.0f) } };
+     * static Hook::Store hook;
+     * hook.create(address, stores, [](SafetyHookContext& ctx) {
+     *     Hook::apply(stores, ctx);
+     * });
+     * @endcode
+     */
+    class Store {
+    public:
+        /**
+         * @brief Install the hook, replaces any hook previously created by this object
+         *
+         * @param target Address of the instruction to store before
+         * @param stores Stores to perform, in order
+         * @param fallback Mid hook doing the same stores
+         * @return true if installed at all, as a stub or as the fallback
+         */
+        bool create(void* target, const std::vector<store_t>& stores, safetyhook::MidHookFn fallback);
+
+        /**
+         * @brief Remove the hook, the original code is restored
+         */
+        void reset();
+
+        /**
+         * @brief Turn the installed hook on or off, the original code runs while it is off
+         * @details safetyhook freezes the other threads while it switches a stub, the
+         *      fallback only flips its bit, so this is safe with the game running.
+         *
+         * @param enable true to turn on
+         * @return true if there is a hook and it was switched
+         */
+        bool setEnabled(bool enable);
+
+        /**
+         * @brief true if the stores run from the stub, false if from the fallback mid hook
+         */
+        bool isStub() const { return (bool)inlineHook; }
+
+    private:
+        SafetyHookInline inlineHook{};
+        Mid midHook{};
+        uint8_t* stub = nullptr;
+    };
+}
@@ -0,0 +1,62 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+namespace Limiter
+{
+    /**
+     * @brief Set the frame rate to limit to, resets the schedule
+     * @details The first call creates the timer, a high resolution waitable timer
+     *      where the OS has them (Windows 10 1803 and later) and a regular one
+     *      otherwise. The regular timer only wakes on the system timer's tick, so
+     *      while a frame rate is set the tick is raised to 1 ms with `timeBeginPeriod`,
+     *      and the spin at the end of each wait is longer to cover the coarser wake ups.
+     *
+     * @param fps Frames per second, 0 or less disables waiting
+     */
+    void configure(double fps);
+
+    /**
+     * @brief Wait until the next frame is due
+     * @details Sleeps on the waitable timer for all but the last part of the frame
+     *      and spins for the rest, so frames go out at even intervals. A frame that
+     *      is already late starts a new schedule instead of the limiter trying to
+     *      catch up with a burst of unlimited frames.
+     */
+    void wait();
+
+    /**
+     * @brief Milliseconds the last `wait` slept and spun, 0 if the frame was late,
+     *      the limiter is off or was just configured
+     * @details Lets frame time measurements tell the game's own work apart from
+     *      the time the limiter held the frame back.
+     */
+    double waitedMs();
+
+    /**
+     * @brief true if the high resolution timer is in use
+     */
+    bool highResolution();
+}
@@ -0,0 +1,88 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <windows.h>
+#include <d3d9.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "render.hpp"
+
+namespace Overlay
+{
+    /**
+     * @brief Frames shown in the frame time graph, one bar each
+     */
+    constexpr size_t graphFrames = 240;
+
+    /**
+     * @brief Frame time at the top of the graph, longer frames are cut off
+     */
+    constexpr double graphMaxMs = 50.0;
+
+    /**
+     * @brief Time between two updates of the text, short enough to follow a
+     *      stutter, long enough to read
+     */
+    constexpr double refreshMs = 500.0;
+
+    /**
+     * @brief Adds the lines shown below the frame rate
+     *
+     * @param lines Lines of the overlay, append to it
+     * @param frames Frames presented since the previous call, for per frame rates
+     */
+    typedef void (*linesCallback_t)(std::vector<std::string>& lines, uint64_t frames);
+
+    /**
+     * @brief Set the callback that adds everything the overlay shows besides the frame rate
+     *
+     * @param callback Runs on the render thread every `refreshMs`
+     */
+    void configure(linesCallback_t callback);
+
+    /**
+     * @brief `Present` callback, times the frame and draws the overlay over the backbuffer
+     * @details Draws in the top left corner with a 5x7 bitmap font baked into a
+     *      texture on first use, text and graph go out in a single `DrawPrimitiveUP`.
+     *      The states it changes are saved in a state block recorded from them and
+     *      put back afterwards, and every call is made in a `Render::Direct` scope,
+     *      so the game and the other callbacks never see any of it. Must run after
+     *      the callbacks that change the backbuffer, e.g. `Scaler::present`, or the
+     *      overlay is changed with it.
+     *
+     * @param present Arguments of `Present`
+     * @param visible false only times the frame
+     */
+    void present(Render::present_t& present, bool visible);
+
+    /**
+     * @brief `onReset` callback, releases the state block, the font texture is managed
+     *      and survives the reset
+     */
+    void reset(IDirect3DDevice9* device);
+}
@@ -0,0 +1,113 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#ifdef PROFILE_HOOKS
+
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <intrin.h>
+
+namespace Profiler
+{
+    /**
+     * @brief Maximum number of hooks that can be profiled, later ones are not counted
+     */
+    constexpr size_t maxSites = 32;
+
+    /**
+     * @brief Counters of one hook, each on its own cache line
+     */
+    typedef struct alignas(64) site_t {
+        const char* name;
+        std::atomic<uint64_t> calls;
+        std::atomic<uint64_t> cycles;
+    } site_t;
+
+    /**
+     * @brief Get the counters for a hook, registering it on first use
+     *
+     * @param name Name of the hook, must outlive the profiler e.g. a string literal
+     * @return Counters of the hook
+     */
+    site_t& site(const char* name);
+
+    /**
+     * @brief Every hook registered so far, in the order they registered
+     * @details The counters keep running, readers take their own deltas.
+     *
+     * @return std::span<const site_t>
+     */
+    std::span<const site_t> registeredSites();
+
+    /**
+     * @brief Counts one call of a hook and the `__rdtsc` cycles spent between
+     *      construction and destruction
+     */
+    class Scope {
+    public:
+        explicit Scope(site_t& site) : site(site), start(__rdtsc()) {}
+        ~Scope() {
+            site.calls.fetch_add(1, std::memory_order_relaxed);
+            site.cycles.fetch_add(__rdtsc() - start, std::memory_order_relaxed);
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        site_t& site;
+        uint64_t start;
+    };
+
+    /**
+     * @brief Counts a presented frame, turns the summary into calls per frame
+     */
+    void frame();
+
+    /**
+     * @brief One line summary of every hook since the previous summary
+     * @details Lists calls per frame, or per second while no frames are counted,
+     *      and the average cycles per call, e.g.
+     *      "centerUiIcons 12.0 calls/frame 85 cycles | textbox 0.5 calls/frame 60 cycles"
+     *
+     * @return std::string
+     */
+    std::string summary();
+}
+
+/**
+ * Counts the calls and cycles of the enclosing hook body. Compiled out entirely
+ * unless the `PROFILE_HOOKS` CMake option is on.
+ */
+#define PROFILE_HOOK(NAME) \
+    static Profiler::site_t& profilerSite = Profiler::site(NAME); \
+    Profiler::Scope profilerScope(profilerSite)
+
+#else
+
+#define PROFILE_HOOK(NAME)
+
+#endif
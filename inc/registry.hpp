@@ -0,0 +1,145 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "utils.hpp"
+#include "signatures.hpp"
+
+/**
+ * @file registry.hpp
+ * @brief Table of every fix that patches or hooks the game's code
+ *
+ * Each entry names the signature it is found by, where its patch goes relative
+ * to the hit, when it is enabled and the action that installs it. Every entry
+ * is found by the one batched scan in `scanSignatures()`, so adding a fix is a
+ * new signature and a new entry, nothing else. When the configuration changes
+ * at runtime `update` brings the entries in line without scanning again.
+ */
+
+namespace Registry
+{
+    /**
+     * @brief When an entry is installed
+     */
+    enum class phase_t {
+        Init,       // From `init()` on the game's main thread, before its own init code runs
+        Frozen      // From `installHooks()` with every other thread suspended
+    };
+
+    /**
+     * @brief Outcome of one entry
+     */
+    enum class state_t {
+        Disabled,   // The predicate said no, nothing was looked up
+        NotFound,   // The signature had no hits
+        Installed,
+        Off,        // Installed, then switched off by `update`
+        Failed      // The action ran and reported failure
+    };
+
+    typedef struct entry_t {
+        const char* name;           // For the log and the timeline, must outlive the registry e.g. a string literal
+        signatureId_t signature;
+        uintptr_t offset;           // From the first hit to where the action applies
+        size_t patchSize;           // Bytes the action overwrites there, kept clear of suspended threads
+        phase_t phase;
+        bool (*enabled)();
+        bool (*install)(uintptr_t address);
+        bool (*toggle)(bool enable);    // Switches an installed entry on or off, nullptr if it can not be
+        const char* notFound;       // Extra hint logged when the signature has no hits, may be nullptr
+    } entry_t;
+
+    typedef struct result_t {
+        const entry_t* entry;
+        state_t state;
+        uintptr_t address;          // Where the action applied, 0 unless found
+        size_t hits;                // Hits of the signature, the first one is used
+    } result_t;
+
+    /**
+     * @brief Code ranges the enabled and found entries of a phase will overwrite
+     * @details Meant for `Utils::suspendAllThreads` so no thread is left stopped
+     *      inside bytes that are about to change.
+     *
+     * @param entries The registry
+     * @param hits Hits per signature from `scanSignatures()`
+     * @param phase Phase about to be installed
+     * @return std::vector<Utils::codeRange_t>
+     */
+    std::vector<Utils::codeRange_t> ranges(const std::vector<entry_t>& entries,
+        const std::vector<std::vector<uint64_t>>& hits, phase_t phase);
+
+    /**
+     * @brief true if any entry found by a signature overwrites code at its hit
+     * @details Such a signature has to resolve uniquely, an entry with a
+     *      `patchSize` of 0 only reads and can live with the closest candidate.
+     *
+     * @param entries The registry
+     * @param signature Signature to look up
+     * @return bool
+     */
+    bool writesCode(const std::vector<entry_t>& entries, signatureId_t signature);
+
+    /**
+     * @brief Install every entry of a phase in table order
+     * @details A signature without hits only skips its own entry, the action is
+     *      never called with a null address. Every action is timed as a
+     *      `Timeline` phase under the entry's name.
+     *
+     * @param entries The registry
+     * @param hits Hits per signature from `scanSignatures()`
+     * @param phase Phase to install
+     * @return One result per entry of the phase
+     */
+    std::vector<result_t> install(const std::vector<entry_t>& entries,
+        const std::vector<std::vector<uint64_t>>& hits, phase_t phase);
+
+    /**
+     * @brief Bring entries installed earlier in line with their predicates again
+     * @details Installed entries with a `toggle` are switched on or off, ones
+     *      without are left alone. Nothing is installed, that is only safe with
+     *      every other thread suspended: an entry that is enabled now but was
+     *      disabled at `install` stays disabled and is added to `restart` if its
+     *      signature has a hit, otherwise it becomes `NotFound`.
+     *
+     * @param hits Hits per signature from `scanSignatures()`
+     * @param results Results of an earlier `install`, updated in place
+     * @param restart Receives the entries that need the next launch to be installed
+     * @return The results whose state changed
+     */
+    std::vector<result_t> update(const std::vector<std::vector<uint64_t>>& hits, std::vector<result_t>& results,
+        std::vector<const entry_t*>* restart);
+
+    /**
+     * @brief Lower case name of a state, e.g. "installed"
+     *
+     * @param state State of a result
+     * @return const char*
+     */
+    const char* stateName(state_t state);
+}
@@ -0,0 +1,213 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <windows.h>
+#include <d3d9.h>
+
+namespace Render
+{
+    /**
+     * @brief Maximum number of callbacks per device function
+     */
+    constexpr size_t maxCallbacks = 8;
+
+    /**
+     * @brief Arguments of `IDirect3DDevice9::Present`, callbacks may change them
+     */
+    typedef struct present_t {
+        IDirect3DDevice9* device;
+        const RECT* sourceRect;
+        const RECT* destRect;
+        HWND window;
+        const RGNDATA* dirtyRegion;
+    } present_t;
+
+    /**
+     * @brief Arguments of `IDirect3DDevice9::DrawPrimitive` or, with `indexed`, of `DrawIndexedPrimitive`
+     */
+    typedef struct draw_t {
+        IDirect3DDevice9* device;
+        D3DPRIMITIVETYPE type;
+        bool indexed;
+        INT baseVertex;         // Indexed only, added to every index
+        UINT minIndex;          // Indexed only, lowest index used
+        UINT vertexCount;       // Indexed only, vertices from `minIndex` on the indices use
+        UINT start;             // First vertex, or first index with `indexed`
+        UINT primitives;
+    } draw_t;
+
+    typedef void (*presentCallback_t)(present_t& present);
+    typedef void (*presentedCallback_t)(IDirect3DDevice9* device);
+    typedef void (*endSceneCallback_t)(IDirect3DDevice9* device);
+    typedef void (*resetCallback_t)(IDirect3DDevice9* device);
+    typedef void (*renderTargetCallback_t)(IDirect3DDevice9* device, DWORD index, IDirect3DSurface9* surface);
+    typedef void (*viewportCallback_t)(IDirect3DDevice9* device, D3DVIEWPORT9& viewport);
+    typedef void (*scissorRectCallback_t)(IDirect3DDevice9* device, RECT& rect);
+    typedef bool (*drawCallback_t)(const draw_t& draw);
+    typedef void (*drawUpCallback_t)(IDirect3DDevice9* device, UINT vertexCount, const void*& vertices, UINT stride);
+
+    /**
+     * @brief Addresses of the device functions that get hooked
+     */
+    typedef struct deviceFunctions_t {
+        void* reset;
+        void* present;
+        void* setRenderTarget;
+        void* endScene;
+        void* setViewport;
+        void* setScissorRect;
+        void* drawPrimitive;
+        void* drawIndexedPrimitive;
+        void* drawPrimitiveUP;
+        void* drawIndexedPrimitiveUP;
+    } deviceFunctions_t;
+
+    /**
+     * @brief Number of vertices, or indices, a draw of `primitives` primitives of `type` reads
+     */
+    UINT primitiveVertices(D3DPRIMITIVETYPE type, UINT primitives);
+
+    /**
+     * @brief Find the device functions through the vtable of a throwaway device
+     * @details Creates a windowed device on a hidden 1x1 window with the `d3d9.dll`
+     *      the game already loaded, reads its vtable and releases everything again.
+     *      Every device of the process shares the same functions. Loads and creates
+     *      things, so it must not be called with threads frozen.
+     *
+     * @param functions Receives the addresses
+     * @return true on success
+     */
+    bool findDeviceFunctions(deviceFunctions_t* functions);
+
+    /**
+     * @brief Read the device functions from the vtable of a device that already exists
+     * @details Nothing is created, meant for the game's own device as passed to a
+     *      `deviceCreatedCallback_t`.
+     *
+     * @param device Any device of the process
+     * @param functions Receives the addresses
+     */
+    void findDeviceFunctions(IDirect3DDevice9* device, deviceFunctions_t* functions);
+
+    typedef void (*deviceCreatedCallback_t)(IDirect3DDevice9* device);
+
+    /**
+     * @brief Run a callback once the game has created its device
+     * @details Points the module's import of `Direct3DCreate9` at a hook that, on the
+     *      first `IDirect3D9` the game gets, points the `CreateDevice` slot of its
+     *      vtable at a second hook. The callback runs on the game's thread right
+     *      after the first `CreateDevice` that succeeds, after which both slots are
+     *      restored and the game calls d3d9 directly again. Only writes two pointers,
+     *      so it can be called from `DllMain`.
+     *
+     * @param module Module whose import is hooked, the game exe
+     * @param callback Must be quick, the game is waiting on its device
+     * @return true if the module imports `Direct3DCreate9` and the import was redirected
+     */
+    bool watchDeviceCreation(HMODULE module, deviceCreatedCallback_t callback);
+
+    /**
+     * @brief Inline hook every device function that has a callback
+     * @details `Present` and `EndScene` are always hooked, the state setters and
+     *      draw calls only when needed since the game calls them many times per frame.
+     *
+     * @param functions Addresses from `findDeviceFunctions`
+     * @return true if every function that needed it is hooked
+     */
+    bool hook(const deviceFunctions_t& functions);
+
+    /**
+     * @brief Run a callback at the start of every `Present`, before the game's frame is presented
+     * @details Callbacks run on the render thread in the order they were added and
+     *      must be added before `hook`.
+     */
+    void onPresent(presentCallback_t callback);
+
+    /**
+     * @brief Run a callback after every `Present` returned, before the game starts its next frame
+     */
+    void afterPresent(presentedCallback_t callback);
+
+    /**
+     * @brief Run a callback at the start of every `EndScene`, the scene is still open
+     */
+    void onEndScene(endSceneCallback_t callback);
+
+    /**
+     * @brief Run a callback before every `Reset`, device resources in `D3DPOOL_DEFAULT`
+     *      must be released here
+     */
+    void onReset(resetCallback_t callback);
+
+    /**
+     * @brief Run a callback after every successful `SetRenderTarget`, which resets the viewport
+     */
+    void afterSetRenderTarget(renderTargetCallback_t callback);
+
+    /**
+     * @brief Run a callback before every `SetViewport`, the viewport may be changed
+     */
+    void onSetViewport(viewportCallback_t callback);
+
+    /**
+     * @brief Run a callback before every `SetScissorRect`, the rect may be changed
+     */
+    void onSetScissorRect(scissorRectCallback_t callback);
+
+    /**
+     * @brief Run a callback before every `DrawPrimitive` and `DrawIndexedPrimitive`
+     * @details A callback that returns true drew the call itself, e.g. from a changed
+     *      copy of the vertices, the game's call is dropped and later callbacks do not run.
+     */
+    void onDraw(drawCallback_t callback);
+
+    /**
+     * @brief Run a callback before every `DrawPrimitiveUP` and `DrawIndexedPrimitiveUP`
+     * @details `vertices` may be pointed at a copy, which has to stay valid until
+     *      the draw returned. `vertexCount` vertices are read from it.
+     */
+    void onDrawUp(drawUpCallback_t callback);
+
+    /**
+     * @brief Device calls made while one of these exists skip every callback
+     * @details For callbacks that make device calls of their own which the other
+     *      callbacks must neither see nor change, e.g. the overlay binding the
+     *      backbuffer while render scaling shrinks every viewport set on it.
+     *      Only for the render thread, which is the only one calling the device.
+     */
+    class Direct {
+    public:
+        Direct();
+        ~Direct();
+        Direct(const Direct&) = delete;
+        Direct& operator=(const Direct&) = delete;
+    };
+
+    /**
+     * @brief true if any callback was added, nothing needs hooking otherwise
+     */
+    bool hasCallbacks();
+}
@@ -0,0 +1,68 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+
+#include "Zydis/Zydis.h"
+
+namespace Resolver
+{
+    /**
+     * @brief What one decoded instruction refers to
+     * @details Every field is 0 when the instruction has no such operand. A memory
+     *      operand is only resolved when its address is known from the instruction
+     *      alone, i.e. an absolute `[disp32]`, one based on a register depends on
+     *      the register at runtime and is left at 0.
+     */
+    typedef struct reference_t {
+        ZydisMnemonic mnemonic;
+        uint8_t length;             // Length of the instruction in bytes, 0 if it could not be decoded
+        uintptr_t memory;           // Absolute address of the memory operand
+        uintptr_t target;           // Absolute target of a relative call or jump
+        uint64_t immediate;         // Value of a non relative immediate operand
+        bool hasImmediate;
+    } reference_t;
+
+    /**
+     * @brief Decode the instruction at an address and resolve what it refers to
+     * @details Results are cached by RVA within `module`, a later call for the same
+     *      instruction, e.g. from a hook installed again after a reload, only looks
+     *      up the cache. Short, unique code signatures can then lead to the game's
+     *      data such as the scalers at Valkyria.exe+13542E4 without spelling out the
+     *      encoding of the instruction that reads them.
+     *
+     * @code
+     * // D9 05 E4 42 75 01 | fld dword ptr [Valkyria.exe+13542E4]
+     * float* scaler = (float*)Resolver::resolve(baseModule, hit).memory;
+     * @endcode
+     *
+     * @param module Base of the module `address` is in
+     * @param address Address of the first byte of the instruction
+     * @return reference_t, `length` is 0 if nothing could be decoded
+     */
+    reference_t resolve(HMODULE module, uintptr_t address);
+}
@@ -0,0 +1,156 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+#include <vector>
+
+#include "Zydis/Zydis.h"
+
+#include "utils.hpp"
+#include "config.hpp"
+
+/**
+ * @file retarget.hpp
+ * @brief Finds every use of the game's hard-coded 1280 and 1920 and rewrites the chosen ones
+ *
+ * The PS3 port keeps its 1280/720 layout in plain constants, as int and float
+ * immediates in the code and as float and double constants in .rdata. Rather
+ * than a signature and a hook for each of them, `index` finds all of them with
+ * one batched scan, works out what each instruction does with its constant and
+ * `apply` rewrites the ones picked by the rules in the yml in a single
+ * `Utils::PatchTransaction`. Adding a constant to the fix is a new rule, the
+ * startup cost stays the same.
+ */
+
+namespace Retarget
+{
+    /**
+     * @brief How the constant is encoded
+     */
+    enum class kind_t {
+        Int,
+        Float,
+        Double
+    };
+
+    /**
+     * @brief What the instruction does with the constant
+     */
+    enum class use_t {
+        Load,           // Into a register or onto the FPU stack, e.g. mov reg, imm or fld [constant]
+        Store,          // Written to memory, e.g. mov dword ptr [ebp-8], imm
+        Compare,        // cmp, fcom, comiss and the like
+        Arithmetic,     // add, fmul, divss and the like
+        Push,           // Passed on the stack
+        Other
+    };
+
+    /**
+     * @brief One instruction using one constant
+     */
+    typedef struct reference_t {
+        uintptr_t instruction;      // First byte of the instruction
+        uintptr_t operand;          // The 32-bit immediate, or displacement pointing at `data`
+        uintptr_t data;             // The constant in .rdata, 0 for an immediate
+        int value;                  // 1280 or 1920
+        kind_t kind;
+        use_t use;
+        ZydisMnemonic mnemonic;
+    } reference_t;
+
+    /**
+     * @brief What one rule matched
+     */
+    typedef struct applied_t {
+        const retargetRule_t* rule;
+        bool valid;                 // Every field could be understood, otherwise nothing matched
+        double to;                  // The value `to` stands for
+        size_t matched;             // References rewritten
+        size_t skipped;             // Matching references inside code a fix patches, left alone
+    } applied_t;
+
+    /**
+     * @brief Find every reference to 1280 and 1920
+     * @details Int and float immediates are searched for in .text, float and double
+     *      constants in .rdata, all in one batched `Utils::cachedPatternScan`. The
+     *      instruction holding an immediate is found by decoding backwards from it,
+     *      the closest start that puts a 32-bit immediate right on the hit wins once
+     *      decoding forward from the padding before the function lands on it too.
+     *      A hit no such start explains is left out, rather than risk writing into
+     *      the middle of an instruction.
+     *      Constants in .rdata have to be aligned to their size and are then looked
+     *      up in the code with a second batched scan for their address, a constant
+     *      nothing refers to is not part of the index. Doubles are only indexed in
+     *      .rdata, 32-bit code can not hold one in an immediate. Cached hits are
+     *      only verified on the next launch, see `Utils::cachedPatternScan`.
+     *
+     * @param module Base of the module to search
+     * @param cachePath Offset cache of the first scan, the second scan uses
+     *      `cachePath` with ".readers" appended
+     * @param threads Number of worker threads to scan with
+     * @return Every reference in address order of the instructions
+     */
+    std::vector<reference_t> index(HMODULE module, const char* cachePath, unsigned threads);
+
+    /**
+     * @brief Rewrite the references the rules pick
+     * @details A reference is picked by the first rule whose value, kind, use and
+     *      RVA all match, `any` and an RVA of 0 match everything. An immediate is
+     *      overwritten with the new value in place. A constant in .rdata is shared
+     *      with every other instruction reading it, so instead the picked
+     *      instruction has its displacement pointed at a copy holding the new
+     *      value, the other readers keep the original. Everything is written by
+     *      one `Utils::PatchTransaction`, if any page can not be made writable
+     *      nothing changes.
+     *
+     * @param module Base of the module the references are in
+     * @param references From `index`
+     * @param rules Rules from the yml
+     * @param constants Values a rule's `to` can name instead of a number, e.g. "width"
+     * @param avoid Code the fixes patch, references in it are never rewritten
+     * @param committed Receives whether the transaction was applied
+     * @return One result per rule
+     */
+    std::vector<applied_t> apply(HMODULE module, const std::vector<reference_t>& references,
+        const std::vector<retargetRule_t>& rules, const constants_t& constants,
+        const std::vector<Utils::codeRange_t>& avoid, bool* committed);
+
+    /**
+     * @brief Write an index to a CSV file, for finding the RVA a rule should pin
+     * @details Columns are `rva,value,kind,use,mnemonic,data_rva` where `data_rva`
+     *      is empty for an immediate.
+     *
+     * @param path Path of the CSV file, overwritten if it exists
+     * @param module Base of the module the references are in
+     * @param references From `index`
+     * @return true on success
+     */
+    bool writeCsv(const char* path, HMODULE module, const std::vector<reference_t>& references);
+
+    const char* kindName(kind_t kind);
+    const char* useName(use_t use);
+}
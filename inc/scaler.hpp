@@ -0,0 +1,115 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <windows.h>
+#include <d3d9.h>
+
+#include "render.hpp"
+
+namespace Scaler
+{
+    /**
+     * @brief Lowest and highest render scale, dynamic scaling stays within them
+     */
+    constexpr float minScale = 0.5f;
+    constexpr float maxScale = 1.0f;
+
+    /**
+     * @brief Change of the render scale per dynamic step
+     */
+    constexpr float scaleStep = 0.05f;
+
+    /**
+     * @brief Frames between two dynamic steps, short enough to react to a heavy
+     *      scene, long enough not to visibly pump between sizes
+     */
+    constexpr int evaluateFrames = 30;
+
+    /**
+     * @brief Set the render scale and whether it follows the frame time
+     * @details With `dynamic` the scale starts at `scale` and after every
+     *      `evaluateFrames` frames steps down when the average frame time misses
+     *      the target and back up when there is headroom.
+     *
+     * @param scale Fraction of the backbuffer rendered to, clamped to `minScale`..`maxScale`
+     * @param dynamic true to adjust the scale to hit `targetFps`
+     * @param targetFps Frame rate dynamic scaling aims for
+     */
+    void configure(float scale, bool dynamic, double targetFps);
+
+    /**
+     * @brief Current render scale
+     */
+    float scale();
+
+    /**
+     * @brief `Present` callback, upscales the rendered part of the backbuffer to all of it
+     * @details Copies the scaled region into an offscreen render target and stretches
+     *      it back over the whole backbuffer with linear filtering, then takes the
+     *      next dynamic step. Frames are measured from one `Present` to the next with
+     *      `waitedMs` taken off, so a frame limiter does not count as load. Must run
+     *      after the limiter's callbacks for `waitedMs` to belong to this frame.
+     *
+     * @param present Arguments of `Present`
+     * @param waitedMs Time another callback held this frame back, e.g. `Limiter::waitedMs`
+     */
+    void present(Render::present_t& present, double waitedMs);
+
+    /**
+     * @brief `onReset` callback, releases the offscreen render target and forgets the backbuffer
+     */
+    void reset(IDirect3DDevice9* device);
+
+    /**
+     * @brief `afterSetRenderTarget` callback, tracks whether the backbuffer is bound
+     *      and scales the full viewport the runtime just set for it
+     */
+    void renderTarget(IDirect3DDevice9* device, DWORD index, IDirect3DSurface9* surface);
+
+    /**
+     * @brief `onSetViewport` callback, scales viewports set on the backbuffer
+     */
+    void viewport(IDirect3DDevice9* device, D3DVIEWPORT9& viewport);
+
+    /**
+     * @brief `onSetScissorRect` callback, scales scissor rects set on the backbuffer
+     */
+    void scissorRect(IDirect3DDevice9* device, RECT& rect);
+
+    /**
+     * @brief `onDraw` callback, draws pre-transformed vertex buffers on the backbuffer
+     *      from a copy with x and y scaled
+     * @details Such vertices are in screen pixels and no viewport moves them. The copy
+     *      needs a buffer created without `D3DUSAGE_WRITEONLY`, other buffers are drawn
+     *      unscaled and land partly outside the rendered region.
+     */
+    bool draw(const Render::draw_t& draw);
+
+    /**
+     * @brief `onDrawUp` callback, scales x and y of pre-transformed vertices drawn on the backbuffer
+     */
+    void drawUp(IDirect3DDevice9* device, UINT vertexCount, const void*& vertices, UINT stride);
+}
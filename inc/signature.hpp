@@ -0,0 +1,226 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace Utils
+{
+    /**
+     * @brief Packed form of an IDA-style byte array pattern
+     * @details Non-owning view, the arrays live either in the static storage of a
+     *      `Signature` or in a pattern parsed at runtime. A byte at offset `i`
+     *      matches when `(data[i] & mask[i]) == bytes[i]`, wildcards have a mask and
+     *      byte of `0x00`. `anchor` and `anchor2` are the offsets of the two rarest
+     *      non-wildcard bytes, both point at the same byte if there is only one.
+     */
+    typedef struct pattern_t {
+        const uint8_t* bytes;
+        const uint8_t* mask;
+        size_t size;
+        size_t anchor;
+        size_t anchor2;
+        bool wildcardOnly;
+        const char* text;       // Original pattern string, for logging
+    } pattern_t;
+
+    namespace detail
+    {
+        /**
+         * Rough frequency ranking of bytes in 32-bit MSVC compiled code, the higher
+         * the value the more often the byte shows up in .text. Anything not listed
+         * is considered rare and is preferred as an anchor.
+         */
+        constexpr auto byteFrequency = [] {
+            constexpr uint8_t common[] = {
+                0x00, 0xFF, 0x8B, 0x89, 0x24, 0x44, 0x45, 0xCC, 0x0F, 0x08,
+                0x04, 0x85, 0x01, 0xE8, 0x10, 0x83, 0x74, 0x0C, 0x50, 0xC7,
+                0x8D, 0x75, 0x56, 0x55, 0x5D, 0xC0, 0x14, 0x18, 0xD9, 0x84,
+                0x6A, 0x90, 0x51, 0x57, 0x53, 0x5E, 0x5F, 0x33, 0x3B, 0xC3,
+                0x02, 0x03, 0x80, 0x20, 0xE9, 0x40, 0xEB, 0x46, 0x4D, 0x06,
+            };
+            std::array<uint8_t, 256> table{};
+            for (size_t i = 0; i < std::size(common); i++) {
+                table[common[i]] = (uint8_t)(std::size(common) - i);
+            }
+            return table;
+        }();
+
+        /**
+         * Picks the two rarest non-wildcard bytes as anchors, if there is only one
+         * then both anchors point at it. Shared by compile time and runtime parsing
+         * so both produce identical patterns.
+         */
+        constexpr void selectAnchors(const uint8_t* bytes, const uint8_t* mask, size_t size, size_t* anchor, size_t* anchor2, bool* wildcardOnly) {
+            size_t best = SIZE_MAX;
+            size_t second = SIZE_MAX;
+            for (size_t i = 0; i < size; i++) {
+                if (!mask[i]) {
+                    continue;
+                }
+                uint8_t rank = byteFrequency[bytes[i]];
+                if (best == SIZE_MAX || rank < byteFrequency[bytes[best]]) {
+                    second = best;
+                    best = i;
+                } else if (second == SIZE_MAX || rank < byteFrequency[bytes[second]]) {
+                    second = i;
+                }
+            }
+            *wildcardOnly = best == SIZE_MAX;
+            *anchor = *wildcardOnly ? 0 : best;
+            *anchor2 = second == SIZE_MAX ? *anchor : second;
+        }
+
+        constexpr bool isSpace(char c) {
+            return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+        }
+
+        constexpr int hexValue(char c) {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            return -1;
+        }
+
+        consteval size_t countTokens(const char* string) {
+            size_t count = 0;
+            for (size_t i = 0; string[i]; i++) {
+                if (!isSpace(string[i]) && (i == 0 || isSpace(string[i - 1]))) {
+                    count++;
+                }
+            }
+            return count;
+        }
+
+        template <size_t N>
+        struct parsedPattern_t {
+            std::array<uint8_t, N> bytes{};
+            std::array<uint8_t, N> mask{};
+            size_t anchor = 0;
+            size_t anchor2 = 0;
+            bool wildcardOnly = true;
+        };
+
+        // Throwing makes the call a non-constant expression, which fails the build
+        template <size_t N>
+        consteval parsedPattern_t<N> parse(const char* string) {
+            if (N == 0) {
+                throw "Signature is empty";
+            }
+            parsedPattern_t<N> parsed{};
+            size_t token = 0;
+            for (size_t i = 0; string[i];) {
+                if (isSpace(string[i])) {
+                    i++;
+                    continue;
+                }
+                size_t length = 0;
+                while (string[i + length] && !isSpace(string[i + length])) {
+                    length++;
+                }
+                if ((length == 1 || length == 2) && string[i] == '?' && string[i + length - 1] == '?') {
+                    parsed.bytes[token] = 0x00;
+                    parsed.mask[token] = 0x00;
+                } else if (length == 2 && hexValue(string[i]) >= 0 && hexValue(string[i + 1]) >= 0) {
+                    parsed.bytes[token] = (uint8_t)(hexValue(string[i]) << 4 | hexValue(string[i + 1]));
+                    parsed.mask[token] = 0xFF;
+                } else {
+                    throw "Signature tokens must be two hex digits, ? or ??";
+                }
+                token++;
+                i += length;
+            }
+            selectAnchors(parsed.bytes.data(), parsed.mask.data(), N, &parsed.anchor, &parsed.anchor2, &parsed.wildcardOnly);
+            return parsed;
+        }
+
+        template <size_t N>
+        consteval std::array<uint8_t, N> parseBytes(const char* string) {
+            parsedPattern_t<N> parsed = parse<N>(string);
+            for (size_t i = 0; i < N; i++) {
+                if (!parsed.mask[i]) {
+                    throw "Patch bytes can not contain wildcards";
+                }
+            }
+            return parsed.bytes;
+        }
+    }
+
+    /**
+     * @brief String literal usable as a template argument
+     */
+    template <size_t N>
+    struct fixedString_t {
+        char data[N]{};
+        consteval fixedString_t(const char (&string)[N]) {
+            for (size_t i = 0; i < N; i++) {
+                data[i] = string[i];
+            }
+        }
+    };
+
+    /**
+     * @brief IDA-style byte array pattern compiled at build time
+     * @details The pattern string is parsed, packed into byte and mask arrays and
+     *      has its scan anchors picked entirely at compile time. A malformed
+     *      pattern, anything other than two hex digits, `?` or `??` per token,
+     *      fails the build. Converts to `pattern_t` for the scanners, no parsing or
+     *      allocation happens at runtime.
+     *
+     * @code
+     * Utils::pattern_t pattern = Utils::Signature<"D9 5D F8 ?? 04">();
+     * @endcode
+     */
+    template <fixedString_t Pattern>
+    struct Signature {
+        static constexpr size_t size = detail::countTokens(Pattern.data);
+        static constexpr detail::parsedPattern_t<size> parsed = detail::parse<size>(Pattern.data);
+
+        constexpr operator pattern_t() const {
+            return {
+                parsed.bytes.data(),
+                parsed.mask.data(),
+                size,
+                parsed.anchor,
+                parsed.anchor2,
+                parsed.wildcardOnly,
+                Pattern.data
+            };
+        }
+    };
+
+    /**
+     * @brief Hex string of patch bytes compiled at build time
+     * @details Same format as `Signature` but wildcards are rejected.
+     *
+     * @code
+     * Utils::patch(address, Utils::Bytes<"90 90 90">);
+     * @endcode
+     */
+    template <fixedString_t Pattern>
+    constexpr std::array<uint8_t, detail::countTokens(Pattern.data)> Bytes = detail::parseBytes<detail::countTokens(Pattern.data)>(Pattern.data);
+}
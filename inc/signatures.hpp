@@ -0,0 +1,160 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+#include <vector>
+
+#include "utils.hpp"
+
+/**
+ * @file signatures.hpp
+ * @brief Signature database of every fix in dllmain.cpp
+ *
+ * Shared with the benchmark so it always measures the signatures that ship.
+ * Every fix has one or more candidate signatures, the first is the one taken
+ * from the build the fix was written against, later ones cover other builds
+ * and are only used when the first does not resolve uniquely. All candidates
+ * of all fixes are resolved in one batched scan per module by `resolveSignatures`.
+ * Every entry of the fix registry in dllmain.cpp names its signature by `signatureId_t`.
+ */
+
+enum signatureId_t {
+    CenterUiIconsSignature,
+    MinimapOverlaySignature,
+    TextboxSignature,
+    UiScalingSignature,
+    ResolutionSignature,
+    SignatureCount
+};
+
+/**
+ * @brief One way of finding a signature
+ */
+typedef struct candidate_t {
+    Utils::signature_t signature;
+    intptr_t fixup = 0;             // Added to every hit, lands it where a hit of the first candidate would be
+    size_t expectedHits = 1;        // Hits in a build it matches, anything else is ambiguous
+    const char* note = "";          // What it matches, for the log
+    const char* module = nullptr;   // Module to search, nullptr is the game exe
+} candidate_t;
+
+// Candidates per signatureId_t. All of them are code patterns so they are only searched for in
+// executable sections. A later candidate may only wildcard or drop bytes the fix does not rely on
+inline const std::vector<std::vector<candidate_t>> signatureDatabase = {
+    {   // CenterUiIconsSignature
+        { { Utils::Signature<"D9 46 64    D9 5C 24 1C    D9 46 68    D9 5C 24 14    D9 46 6C">() }, 0, 1, "original" },
+        { { Utils::Signature<"D9 46 64    D9 5C 24 1C    D9 46 68    D9 5C 24 14">() }, 0, 1, "without the third load" },
+    },
+    {   // MinimapOverlaySignature
+        { { Utils::Signature<"DE C1    DE C9    D9 98 9C 00 00 00">() }, 0, 1, "original" },
+    },
+    {   // TextboxSignature
+        { { Utils::Signature<"D9 5D F8    A8 04    74 0E">() }, 0, 1, "original" },
+        { { Utils::Signature<"D9 5D F8    A8 04    74 ??">() }, 0, 1, "any branch distance" },
+    },
+    {   // UiScalingSignature
+        { { Utils::Signature<"D9 05 ?? ?? ?? ??    D9 98 88 00 00 00    D9 45 08">() }, 0, 1, "original" },
+        { { Utils::Signature<"D9 05 ?? ?? ?? ??    D9 98 88 00 00 00">() }, 0, 1, "without the following load" },
+    },
+    {   // ResolutionSignature
+        { { Utils::Signature<"B8 39 8E E3 38    F7 E3    8B FA    B8 39 8E E3 38">() }, 0, 1, "original" },
+        // The same patch this fix applies, written to the exe on disk by ValkyriaChroniclesPatch or
+        // the ValkyriaChroniclesPatch.py of older releases, patching it again just puts in the
+        // resolution from the yml
+        { { Utils::Signature<"B8 ?? ?? ?? ??    BB ?? ?? ?? ??    B9 ?? ?? ?? ??    BA ?? ?? ?? ??    "
+                             "BE ?? ?? ?? ??    BF ?? ?? ?? ??    90">() }, 0, 1, "patched on disk" },
+    },
+};
+
+/**
+ * @brief true if two `candidate_t::module` names are the same module, compared case insensitively
+ */
+inline bool sameModule(const char* a, const char* b) {
+    return (!a && !b) || (a && b && _stricmp(a, b) == 0);
+}
+
+/**
+ * @brief Every candidate of one module as a flat list, in database order
+ *
+ * @param module Module name as in `candidate_t::module`, nullptr for the game exe
+ * @return std::vector<Utils::signature_t>
+ */
+inline std::vector<Utils::signature_t> databaseSignatures(const char* module = nullptr) {
+    std::vector<Utils::signature_t> flat;
+    for (const std::vector<candidate_t>& candidates : signatureDatabase) {
+        for (const candidate_t& candidate : candidates) {
+            if (sameModule(module, candidate.module)) {
+                flat.push_back(candidate.signature);
+            }
+        }
+    }
+    return flat;
+}
+
+/**
+ * @brief Which candidate a signature was resolved with
+ */
+typedef struct resolved_t {
+    const candidate_t* candidate;   // nullptr if no candidate had any hits
+    size_t index;                   // Index of the candidate within its signature
+    size_t hits;
+    bool unique;                    // The hits are exactly what the candidate expects
+} resolved_t;
+
+/**
+ * @brief Resolve every signature of the database
+ * @details Candidates are grouped by module and every module is scanned once with
+ *      `Utils::cachedPatternScan`, the game exe through `cachePath` and any other
+ *      module through `cachePath` followed by a dot and the module name. Per signature
+ *      the first candidate whose hit count is what it expects wins, without one the
+ *      candidate closest to its expected count that has any hits is used and marked
+ *      as not unique, a caller whose fixes write code at the hits has to reject it,
+ *      see `Registry::writesCode`. Hits are stored with the candidate's fixup applied.
+ *
+ * @param exe Base of the game exe
+ * @param hits Resized to `SignatureCount`, receives the hits of the chosen candidates
+ * @param cachePath Path of the offset cache of the game exe
+ * @param threads Worker threads per scan, see `Utils::patternScan`
+ * @param fromCache Set to true if no module had to be scanned, may be nullptr
+ * @return One `resolved_t` per signature
+ */
+std::vector<resolved_t> resolveSignatures(HMODULE exe, std::vector<std::vector<uint64_t>>* hits, const char* cachePath,
+    unsigned threads, bool* fromCache = nullptr);
+
+/**
+ * @brief Code that replaces the resolution math found by `ResolutionSignature`
+ * @details Hardcodes the registers the game derives its render size from, see
+ *      `resolutionFix` in dllmain.cpp, and is exactly what the second candidate of
+ *      `ResolutionSignature` matches. Shared by the fix and ValkyriaChroniclesPatch
+ *      so the game in memory and the exe on disk get the same bytes.
+ *
+ * @param width Width from the yml
+ * @param height Height from the yml
+ * @param offset Viewport offset, (desktop width - width) / 2
+ * @return 0x1F bytes of code
+ */
+std::vector<uint8_t> resolutionPatch(uint32_t width, uint32_t height, uint32_t offset);
@@ -0,0 +1,94 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <windows.h>
+#include <atomic>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Immutable value readers get with a single acquire load, swapped as a whole
+ * @details Read-copy-update: `publish` copies the new value into a fresh block
+ *      and swaps the pointer, readers never lock and never see half of an update.
+ *      A replaced block is only freed once `graceMs` have passed, far longer than
+ *      any reader holds on to it, hooks and render callbacks read it once per call.
+ *      Readers must not keep the reference past the call they read it in.
+ *
+ * @code
+ * Snapshot<hot_t> hot;
+ * hot.publish(next);                           // Any thread
+ * float left = hot.read().constants.minimapLeft; // Hook body
+ * @endcode
+ */
+template <typename T>
+class Snapshot {
+    static_assert(std::is_trivially_copyable_v<T>, "Snapshots are copied around as plain bytes");
+public:
+    /**
+     * @brief Time a replaced block is kept for readers still looking at it, in ms
+     */
+    static constexpr ULONGLONG graceMs = 1000;
+
+    /**
+     * @brief The current value, a value initialized `T` until the first `publish`
+     */
+    const T& read() const {
+        return *current.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Make a copy of `value` the current value
+     */
+    void publish(const T& value) {
+        const T* next = new T(value);
+        const T* old = current.exchange(next, std::memory_order_acq_rel);
+
+        std::lock_guard lock(retiredMutex);
+        ULONGLONG now = GetTickCount64();
+        std::erase_if(retired, [now](const retired_t& block) {
+            if (now - block.time < graceMs) {
+                return false;
+            }
+            delete block.value;
+            return true;
+        });
+        if (old != &initial) {
+            retired.push_back({ old, now });
+        }
+    }
+
+private:
+    typedef struct retired_t {
+        const T* value;
+        ULONGLONG time;         // GetTickCount64 when it was replaced
+    } retired_t;
+
+    T initial{};
+    std::atomic<const T*> current{ &initial };
+    std::mutex retiredMutex;
+    std::vector<retired_t> retired;
+};
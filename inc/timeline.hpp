@@ -0,0 +1,95 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <windows.h>
+#include <string>
+
+namespace Timeline
+{
+    /**
+     * @brief Maximum number of phases that can be recorded, later phases are dropped
+     */
+    constexpr size_t maxPhases = 64;
+
+    /**
+     * @brief Milliseconds elapsed between the creation of the process and now
+     * @details The process creation time is taken from `GetProcessTimes` and mapped
+     *      onto the `QueryPerformanceCounter` clock the first time any timeline
+     *      function is called, every later timestamp is pure QPC.
+     *
+     * @return double
+     */
+    double sinceProcessStart();
+
+    /**
+     * @brief Marks a point in time, recorded as a phase with no duration
+     *
+     * @param name Name of the event, must outlive the timeline e.g. a string literal
+     */
+    void mark(const char* name);
+
+    /**
+     * @brief Records the time spent between construction and destruction as a phase
+     * @details Costs two `QueryPerformanceCounter` calls, nothing is allocated.
+     *
+     * @code
+     * {
+     *     Timeline::Scope scope("readYml");
+     *     readYml();
+     * }
+     * @endcode
+     */
+    class Scope {
+    public:
+        explicit Scope(const char* name);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        const char* name;
+        LONGLONG start;
+    };
+
+    /**
+     * @brief One line summary of all recorded phases
+     * @details Lists every phase with its duration in milliseconds followed by the
+     *      time since process start at which the last phase ended, e.g.
+     *      "Main @ 152.31 ms | logInit 0.84 ms | readYml 0.41 ms | ... | done @ 160.02 ms"
+     *
+     * @return std::string
+     */
+    std::string summary();
+
+    /**
+     * @brief Write all recorded phases to a CSV file
+     * @details Columns are `phase,start_ms,duration_ms` where `start_ms` is relative
+     *      to process creation.
+     *
+     * @param path Path of the CSV file, overwritten if it exists
+     * @return true on success
+     */
+    bool writeCsv(const char* path);
+}
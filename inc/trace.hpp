@@ -0,0 +1,158 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "hook.hpp"
+
+/**
+ * @file trace.hpp
+ * @brief Binary trace of hook calls, recorded in game and replayed by the benchmark
+ *
+ * A record holds the registers of one hook call and the bytes around every
+ * address its stores write, before and after the hook body ran. The benchmark
+ * replays the records through `Fixes`, so changes to the hook math can be
+ * checked against a session and other resolutions without starting the game.
+ */
+
+namespace Trace
+{
+    constexpr uint32_t magic = 0x54464356;     // "VCFT" in little endian
+    constexpr uint32_t version = 1;
+
+    /**
+     * @brief Bytes kept around every store, centered on it
+     */
+    constexpr size_t windowSize = 64;
+
+    /**
+     * @brief Stores per record, later stores of a hook are not recorded
+     */
+    constexpr size_t maxStores = 4;
+
+    /**
+     * @brief Hooks that can be traced, later ones are not recorded
+     */
+    constexpr size_t maxSites = 16;
+
+    /**
+     * @brief Records kept, about 9 MB, later calls are not recorded
+     */
+    constexpr size_t maxRecords = 16384;
+
+    typedef struct registers_t {
+        uint32_t eax, ebx, ecx, edx, esi, edi, ebp, esp;
+    } registers_t;
+
+    typedef struct window_t {
+        uint32_t address;               // Of before[0]
+        uint8_t before[windowSize];
+        uint8_t after[windowSize];
+    } window_t;
+
+    typedef struct record_t {
+        uint16_t site;                  // Index into `trace_t::sites`
+        uint16_t windows;
+        registers_t registers;
+        window_t window[maxStores];
+    } record_t;
+
+    typedef struct trace_t {
+        int width;                      // Resolution the session ran at
+        int height;
+        std::vector<std::string> sites;
+        std::vector<record_t> records;
+    } trace_t;
+
+    /**
+     * @brief Read a trace written by `dump`
+     *
+     * @param path Path of the trace
+     * @param trace Receives the trace
+     * @return false if the file can not be read or is not a trace of this version
+     */
+    bool read(const char* path, trace_t* trace);
+
+#ifdef TRACE_HOOKS
+    /**
+     * @brief Get the index of a hook, registering it on first use
+     *
+     * @param name Name of the hook, must outlive the trace e.g. a string literal
+     * @return Index of the hook, `maxSites` once full
+     */
+    uint16_t site(const char* name);
+
+    /**
+     * @brief Set the resolution written to the trace
+     */
+    void setResolution(int width, int height);
+
+    /**
+     * @brief Records one call of a hook, the bytes around every store at construction
+     *      and again at destruction
+     * @details Takes a slot with one atomic increment, nothing is allocated or locked.
+     */
+    class Scope {
+    public:
+        Scope(uint16_t site, const SafetyHookContext& ctx, const std::vector<Hook::store_t>& stores);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        record_t* record;
+    };
+
+    /**
+     * @brief Write every record to a file
+     * @details Writes straight from the record table with `WriteFile`, the heap is
+     *      never touched so this is safe to call from `DllMain` while the process
+     *      exits. Does nothing if no call was recorded.
+     *
+     * @param path Path of the file, overwritten if it exists
+     * @return true if the file was written
+     */
+    bool dump(const char* path);
+#endif
+}
+
+#ifdef TRACE_HOOKS
+
+/**
+ * Records the registers and the memory the stores of the enclosing hook body write.
+ * Compiled out entirely unless the `TRACE_HOOKS` CMake option is on.
+ */
+#define TRACE_HOOK(NAME, CTX, STORES) \
+    static uint16_t traceSite = Trace::site(NAME); \
+    Trace::Scope traceScope(traceSite, CTX, STORES)
+
+#else
+
+#define TRACE_HOOK(NAME, CTX, STORES)
+
+#endif
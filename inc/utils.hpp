@@ -27,6 +27,9 @@
 #include <windows.h>
 #include <vector>
 #include <string>
+#include <array>
+
+#include "signature.hpp"
 
 namespace Utils
 {
@@ -91,12 +94,111 @@ namespace Utils
     void patch(uintptr_t address, const char* pattern);
 
     /**
-     * @brief Scan for a given byte pattern on a module
+     * @brief Patch an area of memory with raw bytes
+     * @details Same as `patch` above but the bytes are given directly, e.g. from
+     *      `Utils::Bytes`, so nothing is parsed at runtime.
+     *
+     * @param address Starting memory address
+     * @param bytes Bytes to write
+     * @param size Number of bytes to write
+     */
+    void patch(uintptr_t address, const uint8_t* bytes, size_t size);
+
+    template <size_t N>
+    void patch(uintptr_t address, const std::array<uint8_t, N>& bytes) {
+        patch(address, bytes.data(), N);
+    }
+
+    /**
+     * @brief Collects many writes and applies them with as few protection changes as possible
+     * @details `commit` sorts the touched pages into runs of consecutive pages that share
+     *      the same protection, calls `VirtualProtect` once per run to make it writable,
+     *      writes everything, restores every run and flushes the instruction cache once
+     *      over the whole span. The bytes that were overwritten are kept so `rollback`
+     *      can put them back the same way. Patterns are parsed when added, not on commit.
+     *
+     * @code
+     * Utils::PatchTransaction transaction;
+     * transaction.add(address1, Utils::Bytes<"00 00 A0 44">);
+     * transaction.add(address2, "90 90");
+     * transaction.commit();
+     * @endcode
+     */
+    class PatchTransaction {
+    public:
+        /**
+         * @brief Queue a write, nothing is written until `commit`
+         *
+         * @param address Starting memory address
+         * @param bytes Bytes to write
+         * @param size Number of bytes to write
+         */
+        void add(uintptr_t address, const uint8_t* bytes, size_t size);
+        void add(uintptr_t address, const char* pattern);
+
+        template <size_t N>
+        void add(uintptr_t address, const std::array<uint8_t, N>& bytes) {
+            add(address, bytes.data(), N);
+        }
+
+        /**
+         * @brief Apply every queued write
+         * @details Writes are applied in the order they were added. If any page can not
+         *      be made writable nothing is written at all.
+         *
+         * @return true if every write was applied
+         */
+        bool commit();
+
+        /**
+         * @brief Restore the bytes the last `commit` overwrote, in reverse order
+         *
+         * @return true if the original bytes were restored, false if there was nothing
+         *      committed or a page could not be made writable
+         */
+        bool rollback();
+
+        bool committed() const { return isCommitted; }
+        size_t size() const { return writes.size(); }
+
+    private:
+        typedef struct write_t {
+            uintptr_t address;
+            std::vector<uint8_t> bytes;
+            std::vector<uint8_t> original;
+        } write_t;
+
+        bool apply(bool restore);
+
+        std::vector<write_t> writes;
+        bool isCommitted = false;
+    };
+
+    /**
+     * @brief Scan for a given byte pattern on a module, one byte at a time
      * @details Obtained and modified from:
      *      https://github.com/OneshotGH/CSGOSimple-master/blob/master/CSGOSimple/helpers/utils.cpp
      *      Original implementation is for the most part intact. Modified so that all
      *      the addresses where the pattern is found is appended to the `address` vector,
      *      instead of returning the address when the first instance is found.
+     *      Kept as the reference implementation, `patternScan` must produce the exact
+     *      same results.
+     *
+     * @param module Base of the module to search
+     * @param signature IDA-style byte array pattern
+     * @param address Vector of addresses where the pattern was found
+     */
+    void patternScanScalar(void* module, const char* signature, std::vector<uint64_t>* address);
+
+    /**
+     * @brief Scan for a given byte pattern on a module
+     * @details Picks the two rarest non-wildcard bytes in the signature as anchors
+     *      and compares them against 32 (AVX2) or 16 (SSE2) positions at once, the
+     *      full masked compare only runs on positions where both anchors match.
+     *      The instruction set is detected once at runtime, CPUs without SSE2 fall
+     *      back to a plain byte loop. All the addresses where the pattern is found
+     *      are appended to the `address` vector in ascending order, identical to
+     *      `patternScanScalar`.
      *
      * @param module Base of the module to search
      * @param signature IDA-style byte array pattern
@@ -104,7 +206,173 @@ namespace Utils
      */
     void patternScan(void* module, const char* signature, std::vector<uint64_t>* address);
 
+    /**
+     * @brief Scan for a precompiled byte pattern on a module
+     * @details Same as `patternScan` above without any runtime parsing, the bytes,
+     *      mask and anchors come straight from a `Utils::Signature`.
+     *
+     * @param module Base of the module to search
+     * @param pattern Compiled pattern
+     * @param address Vector of addresses where the pattern was found
+     */
+    void patternScan(void* module, const pattern_t& pattern, std::vector<uint64_t>* address);
+
+    /**
+     * @brief Scan a plain buffer for a precompiled byte pattern
+     * @details Same scanner as above for memory that is not a loaded image, e.g. an
+     *      exe mapped from disk as is, where sections sit at their file offsets.
+     *
+     * @param data Start of the buffer
+     * @param size Size of the buffer in bytes
+     * @param pattern Compiled pattern
+     * @param address Vector of addresses inside the buffer where the pattern was found
+     */
+    void patternScan(const void* data, size_t size, const pattern_t& pattern, std::vector<uint64_t>* address);
+
+    /**
+     * @brief A section of a loaded PE image
+     */
+    typedef struct section_t {
+        char name[IMAGE_SIZEOF_SHORT_NAME + 1];   // Always null terminated
+        uint8_t* base;                            // Absolute address of the section
+        size_t size;                              // Size of the section in memory
+        DWORD characteristics;                    // IMAGE_SCN_* flags
+    } section_t;
+
+    /**
+     * @brief Signature to search for with the batched `patternScan`
+     */
+    typedef struct signature_t {
+        pattern_t pattern;                        // Compiled pattern, see `Utils::Signature`
+        const char* section = nullptr;            // Section to search, e.g. ".text", nullptr = every executable section
+    } signature_t;
+
+    /**
+     * @brief Upper bound on the worker threads of a parallel scan, the game loads
+     *      its own data while the fix is scanning and must not be starved of cores.
+     */
+    constexpr unsigned maxScanThreads = 4;
+
+    /**
+     * @brief Get the section headers of a loaded module
+     * @details Walks the `IMAGE_SECTION_HEADER`s following the NT headers of the
+     *      module, sections are returned in the order they appear in the image.
+     *
+     * @param module Base of the module
+     * @return std::vector<section_t>
+     */
+    std::vector<section_t> getSections(void* module);
+
+    /**
+     * @brief Scan for several byte patterns on a module in a single pass
+     * @details Only the sections of the module are scanned, never the headers or
+     *      the padding between sections. A signature without a section is searched
+     *      for in every section marked `IMAGE_SCN_MEM_EXECUTE`, otherwise only in
+     *      the named section. Memory that is not committed and readable, or is a
+     *      guard page, is skipped.
+     *      Every signature is anchored on its rarest non-wildcard byte and all
+     *      signatures sharing an anchor byte go into the same dispatch table slot.
+     *      Each section is then walked exactly once, whenever a byte matches one of
+     *      the anchors only the signatures in that slot are compared in full. Cost
+     *      therefore stays flat as signatures are added instead of growing with
+     *      one full scan per signature.
+     *
+     *      With `threads` > 1 the sections are split into overlapping chunks, the
+     *      overlap being the longest signature length minus one, which are scanned
+     *      by that many worker threads. Hits are merged back in address order so the
+     *      result is the same as a single threaded scan. Worker threads run at normal
+     *      priority and are capped at `maxScanThreads`.
+     *
+     * @param module Base of the module to search
+     * @param signatures Signatures to search for
+     * @param addresses Resized to `signatures.size()`, `addresses[i]` receives the
+     *      hits for `signatures[i]` in ascending order
+     * @param threads Number of worker threads to scan with, 1 scans on the calling thread
+     *
+     * @code
+     * std::vector<std::vector<uint64_t>> hits;
+     * Utils::patternScan(module, {
+     *     { Utils::Signature<"D9 5D F8 A8 04">() },
+     *     { Utils::Signature<"00 00 A0 44">(), ".rdata" }
+     * }, &hits);
+     * @endcode
+     */
+    void patternScan(void* module, const std::vector<signature_t>& signatures, std::vector<std::vector<uint64_t>>* addresses, unsigned threads = 1);
+
+    /**
+     * @brief Check if the bytes at an address match a pattern
+     * @details The whole pattern must lie within the image of `module`, wildcards
+     *      match any byte.
+     *
+     * @param module Base of the module `address` belongs to
+     * @param address Absolute address to compare at
+     * @param signature IDA-style byte array pattern
+     * @return true if every non-wildcard byte matches
+     */
+    bool patternMatches(void* module, uintptr_t address, const char* signature);
+    bool patternMatches(void* module, uintptr_t address, const pattern_t& pattern);
+
+    /**
+     * @brief Batched `patternScan` backed by an on-disk offset cache
+     * @details The module is fingerprinted by the `TimeDateStamp`, `CheckSum` and
+     *      `SizeOfImage` fields of its NT headers. If the cache file was written for
+     *      the same fingerprint the cached RVAs of each signature are only verified
+     *      with `patternMatches`, no scanning takes place. Signatures that are not
+     *      in the cache, or whose cached hits no longer match, are rescanned together
+     *      in a single batched scan and the cache file is rewritten.
+     *
+     * @param module Base of the module to search
+     * @param signatures Signatures to search for
+     * @param addresses Resized to `signatures.size()`, `addresses[i]` receives the
+     *      hits for `signatures[i]` in ascending order
+     * @param cachePath Path of the cache file
+     * @param threads Number of worker threads to rescan with, see `patternScan`
+     * @return true if every signature was resolved from the cache
+     */
+    bool cachedPatternScan(void* module, const std::vector<signature_t>& signatures, std::vector<std::vector<uint64_t>>* addresses, const char* cachePath, unsigned threads = 1);
+
+    /**
+     * @brief Find the import address table slot of an imported function
+     * @details Walks the import descriptors of `module`, the dll name is compared
+     *      case insensitively. Functions imported by ordinal are skipped. Writing
+     *      a different pointer into the slot redirects every call the module makes
+     *      through it.
+     *
+     * @param module Base of the importing module
+     * @param dll Name of the exporting dll e.g. "KERNEL32.dll"
+     * @param function Name of the imported function
+     * @return Address of the slot, nullptr if `module` does not import the function
+     */
+    void** findImport(void* module, const char* dll, const char* function);
+
     DWORD findProcessID(const char* targetProcess);
-    void suspendAllThreads();
+
+    /**
+     * @brief A range of code that must not hold the instruction pointer of a frozen thread
+     */
+    typedef struct codeRange_t {
+        uintptr_t base;
+        size_t size;
+    } codeRange_t;
+
+    /**
+     * @brief Suspend every thread of the process except the calling one
+     * @details Threads are listed with a Toolhelp snapshot, which is repeated until
+     *      it finds no thread that is not suspended yet. The process heap is locked
+     *      while suspending so no frozen thread can be holding it, the caller is free
+     *      to allocate until `resumeAllThreads`.
+     *      A thread stopped with its instruction pointer in one of `avoid` would resume
+     *      in the middle of half patched code, so it is let run for a moment and stopped
+     *      again until it has moved on.
+     *
+     * @param avoid Ranges that are about to be patched
+     * @return true if every thread was suspended outside of `avoid`, on false no
+     *      thread is left suspended
+     */
+    bool suspendAllThreads(const std::vector<codeRange_t>& avoid = {});
+
+    /**
+     * @brief Resume every thread suspended by `suspendAllThreads`
+     */
     void resumeAllThreads();
 }
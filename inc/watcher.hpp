@@ -0,0 +1,53 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <windows.h>
+
+namespace Watcher
+{
+    /**
+     * @brief Time a change is given to settle before it is reported, in ms
+     * @details Editors often save in more than one write, or write a temporary
+     *      file and rename it over the original.
+     */
+    constexpr DWORD settleMs = 100;
+
+    typedef void (*changed_t)();
+
+    /**
+     * @brief Watch a file for changes on a background thread
+     * @details Blocks in `ReadDirectoryChangesW` on the directory of the file on its
+     *      own lowest priority thread, so nothing is polled. `changed` runs on that
+     *      thread every time the file is written, created or renamed to. The thread
+     *      runs until the process exits.
+     *
+     * @param directory Directory the file is in
+     * @param file Name of the file in `directory`, compared case insensitively
+     * @param changed Called after every change
+     * @return true if the directory could be opened and the thread started
+     */
+    bool start(const char* directory, const char* file, changed_t changed);
+}
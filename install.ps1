@@ -41,7 +41,6 @@ $scriptsFolder = "scripts"
 $fullPath = "$gameFolder\$gameSubFolder\$scriptsFolder"
 
 $fixName = "ValkyriaChroniclesFix"
-$pyPatch = "ValkyriaChroniclesPatch.py"
 
 $ymlFileContent = @"
 name: Valkyria Chronicles Fix
@@ -62,6 +61,73 @@ fixes:
   # If disabled HUD will span up to chosen resolution from above
   centerHud:
     enable: true
+
+# Startup timing, a summary is always logged
+timeline:
+
+  # If enabled also writes the per-phase breakdown to ValkyriaChroniclesFix.timeline.csv
+  csv: false
+
+# Frame time recorder
+frametime:
+
+  # If enabled records the time of every frame, press F10 to log 1%/0.1% lows and
+  # write ValkyriaChroniclesFix.frametimes.csv
+  enable: false
+
+# Frame limiter
+frameLimiter:
+
+  # If enabled frames are limited to fps and presented at even intervals
+  enable: false
+  fps: 60
+
+  # pacing: waits right before a frame is presented, frames go out evenly spaced
+  # latency: waits right after, so the next frame samples input as late as possible
+  mode: pacing
+
+# Render resolution scaling
+renderScale:
+
+  # If enabled the game renders to scale * resolution and is stretched up to the full resolution.
+  # The HUD is drawn into the same buffer, so it is scaled as well
+  enable: false
+  scale: 0.75
+
+  # If enabled the scale moves between 0.5 and 1.0 to hold targetFps, starting from scale
+  dynamic: false
+  targetFps: 60
+
+# Rewrites the game's hard-coded 1280 and 1920, every rule picks some of the instructions using them
+retarget:
+
+  # If enabled writes every use of 1280 and 1920 to ValkyriaChroniclesFix.constants.csv
+  csv: false
+
+  # value: 1280 or 1920
+  # kind:  int, float, double or any
+  # use:   load, store, compare, arithmetic, push, other or any
+  # rva:   only the instruction at this rva from the csv, 0 for all of them
+  # to:    a number or one of width, height, defaultWidth, centerOffset, uiOffset, uiScaleRatio, ...
+  rules: []
+  #  - value: 1920
+  #    kind: float
+  #    use: load
+  #    rva: 0x123456
+  #    to: 1280
+
+# Performance overlay
+overlay:
+
+  # If enabled draws fps, a frame time graph, the render scale and the state of every fix
+  # in the top left corner, press F11 to show or hide it
+  enable: false
+
+# Logging
+log:
+
+  # One of trace, debug, info, warn, err, critical or off
+  level: info
 "@
 
 if (Test-Path -Path $gameFolder) {
@@ -71,10 +137,6 @@ if (Test-Path -Path $gameFolder) {
     Write-Output "Copying DLL to $fullPath"
     Copy-Item -Path $dllPath -Destination "$fullPath"
     Move-Item -Path $fullPath\$fixName.dll -Destination $fullPath\$fixName.asi -Force
-    Write-Output "Copying $pyPatch to $fullPath"
-    Copy-Item -Path $PSScriptRoot\$pyPatch -Destination "$fullPath"
-    Write-Host "Running PyInstaller..."
-    pyinstaller --specpath $fullPath --distpath $fullPath --onefile $fullPath\$pyPatch
     Write-Output "Creating $fixName.yml at $fullPath"
     New-Item -Path $fullPath -Name "$fixName.yml" -ItemType File -Value $ymlFileContent -Force | Out-Null
     Write-Output "Done!"
@@ -0,0 +1,545 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file bench.cpp
+ * @brief Offline benchmark of the signature scanners
+ *
+ * Runs every scanner in utils.cpp against a Valkyria.exe image outside of the game
+ * and against synthetic worst cases, printing ns/byte and hit counts so scanner
+ * regressions show up per commit.
+ *
+ * Usage:
+ *      ValkyriaChroniclesFix_bench.exe [--dump] [--iterations N] [path to Valkyria.exe]
+ *      ValkyriaChroniclesFix_bench.exe --replay <ValkyriaChroniclesFix.trace> [--iterations N]
+ *
+ * By default the exe is mapped as an image with `LoadLibraryEx`, so sections sit at
+ * their RVAs exactly like in the game. `--dump` reads a raw dump of the loaded image
+ * taken from memory at runtime (e.g. with x64dbg) as is instead, to scan the code as
+ * the game runs it. Without a path only the synthetic cases run.
+ *
+ * `--replay` runs the hook calls recorded by a `TRACE_HOOKS` build through the
+ * stores in fixes.cpp instead, on a copy of the recorded memory. At the resolution
+ * of the session the result has to match what the game ended up with, at the
+ * resolutions of `references` it has to match values worked out by hand. Every
+ * byte that is not stored to has to stay untouched.
+ */
+
+// System includes
+#include <windows.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Local includes
+#include "utils.hpp"
+#include "signatures.hpp"
+#include "config.hpp"
+#include "fixes.hpp"
+#include "trace.hpp"
+
+typedef struct image_t {
+    uint8_t* base;
+    size_t size;            // SizeOfImage
+    size_t executable;      // Bytes in executable sections
+} image_t;
+
+typedef std::vector<std::vector<uint64_t>> hits_t;
+
+// What the fixes have to write at one resolution, worked out by hand and not with config.cpp
+typedef struct reference_t {
+    int width;
+    int height;
+    float minimapLeft;      // (164 - 77 * width / defaultWidth) * 2 + centerOffset
+    float minimapRight;     // (164 + 77 * width / defaultWidth) * 2 + centerOffset
+} reference_t;
+
+typedef struct replaySite_t {
+    const char* name;                                                       // As passed to TRACE_HOOK
+    std::vector<Hook::store_t> (*stores)(const constants_t&, uintptr_t);    // Stores of the fix, given the absolute address
+    std::vector<float> (*expected)(const reference_t&);                     // Value of every store
+} replaySite_t;
+
+typedef struct replay_t {
+    const replaySite_t* site;
+    std::vector<uint8_t> memory;    // From the lowest to the highest recorded byte
+    uint32_t low;                   // Address of memory[0] in the game
+    SafetyHookContext ctx;          // Recorded registers, pointing into memory
+} replay_t;
+
+int iterations = 10;
+
+// Records whose windows lie further apart than this are skipped
+constexpr size_t maxReplaySpan = 4096;
+
+const reference_t references[] = {
+    { 2560, 1080, 442.66667f, 853.33333f },     // 21:9, centerOffset 320
+    { 3440, 1440, 561.0625f, 974.9375f },       // 21:9, centerOffset 440
+    { 5120, 1440, 1300.0f, 1916.0f },           // 32:9, centerOffset 1280
+    { 7680, 1440, 2426.0f, 3350.0f },           // 48:9, centerOffset 2560
+};
+
+// 1280 and 2.0 are what the game uses at 16:9, the HUD fixes put them back at any width
+const replaySite_t replaySites[] = {
+    { "centerUiIcons",
+        [](const constants_t&, uintptr_t) { return Fixes::centerUiIcons(); },
+        [](const reference_t&) { return std::vector<float>{ 1280.0f }; } },
+    { "minimapOverlay",
+        [](const constants_t& constants, uintptr_t) { return Fixes::minimapOverlay(constants); },
+        [](const reference_t& reference) { return std::vector<float>{ reference.minimapLeft, reference.minimapRight }; } },
+    { "textbox",
+        [](const constants_t&, uintptr_t) { return Fixes::textbox(); },
+        [](const reference_t&) { return std::vector<float>{ 1280.0f }; } },
+    { "uiScaling",
+        [](const constants_t&, uintptr_t absolute) { return Fixes::uiScaling(absolute); },
+        [](const reference_t&) { return std::vector<float>{ 2.0f }; } },
+};
+
+/**
+ * @brief Maps an exe from disk as an image, sections are placed at their RVAs.
+ *
+ * @param path Path to the exe
+ * @return Base of the image, nullptr on failure
+ */
+uint8_t* mapImage(const char* path) {
+    HMODULE module = LoadLibraryExA(path, nullptr, LOAD_LIBRARY_AS_IMAGE_RESOURCE);
+    // The low bits of the handle flag a resource mapping, the image starts at the allocation
+    return module ? (uint8_t*)((uintptr_t)module & ~(uintptr_t)0xFFFF) : nullptr;
+}
+
+/**
+ * @brief Reads a raw dump of a loaded image, the file is already laid out like in memory.
+ *
+ * @param path Path to the dump
+ * @return Base of the image, nullptr on failure
+ */
+uint8_t* readDump(const char* path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return nullptr;
+    }
+    size_t size = (size_t)file.tellg();
+    auto base = (uint8_t*)VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (base) {
+        file.seekg(0);
+        file.read((char*)base, size);
+    }
+    return base;
+}
+
+/**
+ * @brief Builds a minimal PE image in memory with a single executable section.
+ *
+ * @param size Size of the whole image, the section starts at 0x1000
+ * @param fill Fills the section
+ * @return Base of the image
+ */
+uint8_t* syntheticImage(size_t size, const std::function<void(uint8_t*, size_t)>& fill) {
+    auto base = (uint8_t*)VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    auto dosHeader = (PIMAGE_DOS_HEADER)base;
+    dosHeader->e_magic = IMAGE_DOS_SIGNATURE;
+    dosHeader->e_lfanew = 0x80;
+    auto ntHeaders = (PIMAGE_NT_HEADERS)(base + dosHeader->e_lfanew);
+    ntHeaders->Signature = IMAGE_NT_SIGNATURE;
+    ntHeaders->FileHeader.NumberOfSections = 1;
+    ntHeaders->FileHeader.SizeOfOptionalHeader = sizeof(IMAGE_OPTIONAL_HEADER);
+    ntHeaders->OptionalHeader.SizeOfImage = (DWORD)size;
+    auto section = IMAGE_FIRST_SECTION(ntHeaders);
+    memcpy(section->Name, ".text", 5);
+    section->VirtualAddress = 0x1000;
+    section->Misc.VirtualSize = (DWORD)(size - 0x1000);
+    section->SizeOfRawData = (DWORD)(size - 0x1000);
+    section->Characteristics = IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE | IMAGE_SCN_MEM_READ;
+    fill(base + 0x1000, size - 0x1000);
+    return base;
+}
+
+image_t describe(uint8_t* base) {
+    auto dosHeader = (PIMAGE_DOS_HEADER)base;
+    auto ntHeaders = (PIMAGE_NT_HEADERS)(base + dosHeader->e_lfanew);
+    image_t image{ base, ntHeaders->OptionalHeader.SizeOfImage, 0 };
+    for (const Utils::section_t& section : Utils::getSections(base)) {
+        if (section.characteristics & IMAGE_SCN_MEM_EXECUTE) {
+            image.executable += section.size;
+        }
+    }
+    return image;
+}
+
+/**
+ * @brief Runs a scanner `iterations` times and prints the best time.
+ *
+ * @param name Name of the scanner
+ * @param bytes Bytes the scanner walks, used for ns/byte
+ * @param scan Runs the scanner once, returns the hits of every signature
+ * @return Hits of the last run
+ */
+hits_t measure(const char* name, size_t bytes, const std::function<hits_t()>& scan) {
+    hits_t hits;
+    double best = 1e300;
+    for (int i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        hits = scan();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count());
+    }
+    size_t total = 0;
+    for (const auto& h : hits) {
+        total += h.size();
+    }
+    printf("  %-10s %10.3f ms %8.4f ns/byte %8zu hits\n", name, best / 1e6, best / (double)bytes, total);
+    return hits;
+}
+
+/**
+ * @brief Benchmarks every scanner against one image and set of signatures.
+ *
+ * @param name Name of the case
+ * @param image Image to scan
+ * @param set Signatures to scan for
+ */
+void runCase(const char* name, const image_t& image, const std::vector<Utils::signature_t>& set) {
+    printf("%s: %zu signature(s), %zu bytes image, %zu bytes executable\n", name, set.size(), image.size, image.executable);
+
+    hits_t scalar = measure("scalar", image.size * set.size(), [&] {
+        hits_t hits(set.size());
+        for (size_t i = 0; i < set.size(); i++) {
+            Utils::patternScanScalar(image.base, set[i].pattern.text, &hits[i]);
+        }
+        return hits;
+    });
+    hits_t simd = measure("simd", image.size * set.size(), [&] {
+        hits_t hits(set.size());
+        for (size_t i = 0; i < set.size(); i++) {
+            Utils::patternScan(image.base, set[i].pattern, &hits[i]);
+        }
+        return hits;
+    });
+    hits_t multi = measure("multi", image.executable, [&] {
+        hits_t hits;
+        Utils::patternScan(image.base, set, &hits, 1);
+        return hits;
+    });
+    hits_t parallel = measure("parallel", image.executable, [&] {
+        hits_t hits;
+        Utils::patternScan(image.base, set, &hits, Utils::maxScanThreads);
+        return hits;
+    });
+
+    // SIMD has to match scalar exactly, the batched scanners only look at executable sections
+    if (simd != scalar) {
+        printf("  MISMATCH: simd differs from scalar\n");
+    }
+    if (parallel != multi) {
+        printf("  MISMATCH: parallel differs from multi\n");
+    }
+    for (size_t i = 0; i < set.size(); i++) {
+        for (uint64_t hit : multi[i]) {
+            if (std::find(scalar[i].begin(), scalar[i].end(), hit) == scalar[i].end()) {
+                printf("  MISMATCH: multi hit 0x%llx for '%s' not found by scalar\n",
+                    (unsigned long long)(hit - (uint64_t)image.base), set[i].pattern.text);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Synthetic cases that stress the weak spots of each scanner.
+ */
+void runSynthetic() {
+    constexpr size_t size = 16 * 1024 * 1024;
+
+    // Both anchors match almost everywhere, so nearly every position gets a full compare
+    // that only fails after 31 bytes
+    image_t zeros = describe(syntheticImage(size, [](uint8_t* data, size_t size) {
+        memset(data, 0x00, size);
+        for (size_t i = 31; i < size; i += 32) {
+            data[i] = 0x01;
+        }
+    }));
+    runCase("synthetic: all anchors hit", zeros, {
+        { Utils::Signature<"00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 "
+                           "00 00 00 00 00 00 00 00 00 00 00 00 00 00 00 00">() },
+    });
+
+    // Pseudo code made of the most common x86 bytes, patterns that are mostly wildcards
+    image_t common = describe(syntheticImage(size, [](uint8_t* data, size_t size) {
+        constexpr uint8_t bytes[] = { 0x8B, 0x89, 0x24, 0x44, 0x45, 0xCC, 0x0F, 0x08, 0xD9, 0x5D };
+        uint32_t state = 0x12345678;
+        for (size_t i = 0; i < size; i++) {
+            state = state * 1664525u + 1013904223u;
+            data[i] = bytes[(state >> 24) % std::size(bytes)];
+        }
+    }));
+    runCase("synthetic: wildcard heavy", common, {
+        { Utils::Signature<"8B ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? 89">() },
+        { Utils::Signature<"D9 ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? ?? 5D">() },
+    });
+
+    // More distinct anchor bytes than the vector compares handle, forces the table lookup
+    runCase("synthetic: many anchors", common, {
+        { Utils::Signature<"8B 89 24 44 A1">() }, { Utils::Signature<"89 24 44 45 A2">() },
+        { Utils::Signature<"24 44 45 CC A3">() }, { Utils::Signature<"44 45 CC 0F A4">() },
+        { Utils::Signature<"45 CC 0F 08 A5">() }, { Utils::Signature<"CC 0F 08 D9 A6">() },
+        { Utils::Signature<"0F 08 D9 5D A7">() }, { Utils::Signature<"08 D9 5D 8B A8">() },
+        { Utils::Signature<"D9 5D 8B 89 A9">() }, { Utils::Signature<"5D 8B 89 24 AA">() },
+        { Utils::Signature<"8B 8B 8B 8B AB">() }, { Utils::Signature<"89 89 89 89 AC">() },
+    });
+}
+
+/**
+ * @brief Copies the memory of a record and points its registers at the copy
+ *
+ * @param trace Trace the record is from
+ * @param record Record to copy
+ * @param replay Receives the copy
+ * @return false if the site is not known or the windows are too far apart
+ */
+bool prepare(const Trace::trace_t& trace, const Trace::record_t& record, replay_t* replay) {
+    const std::string& name = trace.sites[record.site];
+    auto site = std::find_if(std::begin(replaySites), std::end(replaySites),
+        [&](const replaySite_t& s) { return name == s.name; });
+    if (site == std::end(replaySites) || record.windows == 0) {
+        return false;
+    }
+    uint32_t low = UINT32_MAX, high = 0;
+    for (size_t i = 0; i < record.windows; i++) {
+        low = std::min(low, record.window[i].address);
+        high = std::max(high, record.window[i].address + (uint32_t)Trace::windowSize);
+    }
+    if (high - low > maxReplaySpan) {
+        return false;
+    }
+    replay->site = site;
+    replay->low = low;
+    replay->memory.assign(high - low, 0);
+    for (size_t i = 0; i < record.windows; i++) {
+        memcpy(replay->memory.data() + (record.window[i].address - low), record.window[i].before, Trace::windowSize);
+    }
+
+    // Every register moves by the same amount, whichever one the stores use lands in the copy
+    uintptr_t delta = (uintptr_t)replay->memory.data() - low;
+    const Trace::registers_t& r = record.registers;
+    replay->ctx = {};
+    replay->ctx.eax = r.eax + delta;
+    replay->ctx.ebx = r.ebx + delta;
+    replay->ctx.ecx = r.ecx + delta;
+    replay->ctx.edx = r.edx + delta;
+    replay->ctx.esi = r.esi + delta;
+    replay->ctx.edi = r.edi + delta;
+    replay->ctx.ebp = r.ebp + delta;
+    replay->ctx.esp = r.esp + delta;
+    return true;
+}
+
+/**
+ * @brief Address in the game the byte at `offset` of a replay was recorded at
+ */
+uint32_t gameAddress(const replay_t& replay, size_t offset) {
+    return replay.low + (uint32_t)offset;
+}
+
+/**
+ * @brief Replays every record at one resolution and prints the mismatches per site
+ *
+ * @param trace Trace to replay
+ * @param reference Resolution to replay at and what has to be written there, nullptr
+ *      replays at the session's resolution and checks against what the game ended up with
+ * @return Number of mismatching records
+ */
+size_t replayResolution(const Trace::trace_t& trace, const reference_t* reference) {
+    bool session = !reference;
+    int width = session ? trace.width : reference->width;
+    int height = session ? trace.height : reference->height;
+    constants_t constants = Config::computeConstants({ width, height, (float)width / (float)height });
+    printf("replay at %dx%d%s\n", width, height, session ? " (session)" : "");
+
+    std::vector<size_t> calls(std::size(replaySites)), mismatches(std::size(replaySites));
+    size_t skipped = 0;
+    for (const Trace::record_t& record : trace.records) {
+        replay_t replay;
+        if (!prepare(trace, record, &replay)) {
+            skipped++;
+            continue;
+        }
+        size_t index = replay.site - replaySites;
+        uintptr_t delta = (uintptr_t)replay.memory.data() - replay.low;
+        std::vector<Hook::store_t> stores = replay.site->stores(constants,
+            record.window[0].address + Trace::windowSize / 2 + delta);
+        std::vector<float> expected = session ? std::vector<float>(stores.size()) : replay.site->expected(*reference);
+        std::vector<uint8_t> before = replay.memory;
+        Hook::apply(stores, replay.ctx);
+
+        // What the game ended up with, for every byte a recorded window covers
+        std::vector<uint8_t> after = before;
+        std::vector<bool> covered(before.size());
+        for (size_t i = 0; i < record.windows; i++) {
+            size_t offset = record.window[i].address - replay.low;
+            memcpy(after.data() + offset, record.window[i].after, Trace::windowSize);
+            std::fill(covered.begin() + offset, covered.begin() + offset + Trace::windowSize, true);
+        }
+
+        bool ok = stores.size() == expected.size();
+        std::vector<bool> stored(before.size());
+        for (size_t i = 0; ok && i < stores.size(); i++) {
+            size_t offset = Hook::address(stores[i], replay.ctx) - (uintptr_t)replay.memory.data();
+            if (offset + sizeof(float) > replay.memory.size()) {
+                ok = false;
+                break;
+            }
+            std::fill(stored.begin() + offset, stored.begin() + offset + sizeof(float), true);
+            float value;
+            memcpy(&value, replay.memory.data() + offset, sizeof(value));
+            if (session) {
+                ok = memcmp(replay.memory.data() + offset, after.data() + offset, sizeof(float)) == 0;
+            } else {
+                ok = std::fabs(value - expected[i]) <= 1e-4f * std::max(1.0f, std::fabs(expected[i]));
+            }
+            if (!ok) {
+                printf("  MISMATCH: %s store %zu at 0x%08x wrote %f, expected %f\n", replay.site->name, i,
+                    gameAddress(replay, offset), value, session ? *(float*)(after.data() + offset) : expected[i]);
+            }
+        }
+        for (size_t offset = 0; ok && offset < before.size(); offset++) {
+            if (covered[offset] && !stored[offset] && replay.memory[offset] != before[offset]) {
+                printf("  MISMATCH: %s wrote 0x%08x, which is not one of its stores\n", replay.site->name,
+                    gameAddress(replay, offset));
+                ok = false;
+            }
+        }
+        calls[index]++;
+        mismatches[index] += !ok;
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < std::size(replaySites); i++) {
+        if (calls[i]) {
+            printf("  %-16s %8zu calls %8zu mismatches\n", replaySites[i].name, calls[i], mismatches[i]);
+        }
+        total += mismatches[i];
+    }
+    if (skipped) {
+        printf("  %zu record(s) of unknown sites or too far apart skipped\n", skipped);
+    }
+    return total;
+}
+
+/**
+ * @brief Times the stores of every site over its records, best of `iterations`
+ *
+ * @param trace Trace to replay, at the resolution of the session
+ */
+void replayTiming(const Trace::trace_t& trace) {
+    constants_t constants = Config::computeConstants(
+        { trace.width, trace.height, (float)trace.width / (float)trace.height });
+    printf("replay timing, Hook::apply only, the hook itself is not included\n");
+    for (const replaySite_t& site : replaySites) {
+        std::vector<replay_t> replays;
+        std::vector<std::vector<Hook::store_t>> stores;
+        for (const Trace::record_t& record : trace.records) {
+            replay_t replay;
+            if (prepare(trace, record, &replay) && replay.site == &site) {
+                uintptr_t delta = (uintptr_t)replay.memory.data() - replay.low;
+                stores.push_back(site.stores(constants, record.window[0].address + Trace::windowSize / 2 + delta));
+                replays.push_back(std::move(replay));
+            }
+        }
+        if (replays.empty()) {
+            continue;
+        }
+        double best = 1e300;
+        for (int i = 0; i < iterations; i++) {
+            auto start = std::chrono::steady_clock::now();
+            for (size_t j = 0; j < replays.size(); j++) {
+                Hook::apply(stores[j], replays[j].ctx);
+            }
+            auto end = std::chrono::steady_clock::now();
+            best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count());
+        }
+        printf("  %-16s %8.2f ns/call\n", site.name, best / (double)replays.size());
+    }
+}
+
+/**
+ * @brief Replays a trace at the resolution of the session and at every reference
+ *
+ * @param path Path of the trace
+ * @return Exit code, 1 on any mismatch
+ */
+int replay(const char* path) {
+    Trace::trace_t trace;
+    if (!Trace::read(path, &trace)) {
+        printf("Could not read %s, or it is not a trace of this version\n", path);
+        return 1;
+    }
+    printf("%s: %zu record(s) of %zu site(s), recorded at %dx%d\n", path, trace.records.size(),
+        trace.sites.size(), trace.width, trace.height);
+    size_t mismatches = replayResolution(trace, nullptr);
+    for (const reference_t& reference : references) {
+        mismatches += replayResolution(trace, &reference);
+    }
+    replayTiming(trace);
+    return mismatches ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    const char* path = nullptr;
+    const char* trace = nullptr;
+    bool dump = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--dump") {
+            dump = true;
+        } else if (arg == "--replay" && i + 1 < argc) {
+            trace = argv[++i];
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            iterations = std::max(1, atoi(argv[++i]));
+        } else {
+            path = argv[i];
+        }
+    }
+
+    printf("Compiler: %s, %d iteration(s), best time is reported\n", Utils::getCompilerInfo().c_str(), iterations);
+    if (trace) {
+        return replay(trace);
+    }
+    if (path) {
+        uint8_t* base = dump ? readDump(path) : mapImage(path);
+        if (!base) {
+            printf("Could not load %s\n", path);
+            return 1;
+        }
+        runCase(path, describe(base), databaseSignatures());
+    }
+    runSynthetic();
+    return 0;
+}
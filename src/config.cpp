@@ -0,0 +1,275 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Windows.h>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#include "yaml-cpp/yaml.h"
+
+#include "config.hpp"
+
+namespace
+{
+    // Bump whenever a field is added to `visitFields`, old binary copies are then ignored
+    constexpr uint32_t cacheMagic = 0x42464356;    // "VCFB" in little endian
+    constexpr uint32_t cacheVersion = 7;
+
+    typedef struct cacheHeader_t {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t ymlSize;
+        uint64_t ymlWriteTime;
+    } cacheHeader_t;
+
+    /**
+     * Every value stored in the binary copy, in order. Reading and writing both go
+     * through here so the two can never disagree on the layout.
+     */
+    template <typename F>
+    void visitFields(retargetRule_t& rule, F&& field) {
+        field(rule.value);
+        field(rule.kind);
+        field(rule.use);
+        field(rule.rva);
+        field(rule.to);
+    }
+
+    template <typename F>
+    void visitFields(yml_t& yml, F&& field) {
+        field(yml.name);
+        field(yml.masterEnable);
+        field(yml.resolution.width);
+        field(yml.resolution.height);
+        field(yml.fix.centerHud.enable);
+        field(yml.timeline.csv);
+        field(yml.frametime.enable);
+        field(yml.frameLimiter.enable);
+        field(yml.frameLimiter.fps);
+        field(yml.frameLimiter.mode);
+        field(yml.renderScale.enable);
+        field(yml.renderScale.scale);
+        field(yml.renderScale.dynamic);
+        field(yml.renderScale.targetFps);
+        field(yml.retarget.csv);
+        field(yml.retarget.rules);
+        field(yml.overlay.enable);
+        field(yml.log.level);
+    }
+
+    typedef struct writer_t {
+        std::vector<uint8_t> data;
+
+        template <typename T>
+        void operator()(const T& value) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            auto bytes = reinterpret_cast<const uint8_t*>(&value);
+            data.insert(data.end(), bytes, bytes + sizeof(T));
+        }
+
+        void operator()(const std::string& value) {
+            (*this)((uint32_t)value.size());
+            data.insert(data.end(), value.begin(), value.end());
+        }
+
+        template <typename T>
+        void operator()(std::vector<T>& values) {
+            (*this)((uint32_t)values.size());
+            for (T& value : values) {
+                visitFields(value, *this);
+            }
+        }
+    } writer_t;
+
+    typedef struct reader_t {
+        const uint8_t* current;
+        const uint8_t* end;
+        bool ok = true;
+
+        template <typename T>
+        void operator()(T& value) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            if (!ok || (size_t)(end - current) < sizeof(T)) {
+                ok = false;
+                return;
+            }
+            memcpy(&value, current, sizeof(T));
+            current += sizeof(T);
+        }
+
+        void operator()(std::string& value) {
+            uint32_t size = 0;
+            (*this)(size);
+            if (!ok || (size_t)(end - current) < size) {
+                ok = false;
+                return;
+            }
+            value.assign((const char*)current, size);
+            current += size;
+        }
+
+        template <typename T>
+        void operator()(std::vector<T>& values) {
+            uint32_t size = 0;
+            (*this)(size);
+            // Every element takes at least a byte, a corrupt count can not allocate much
+            if (!ok || (size_t)(end - current) < size) {
+                ok = false;
+                return;
+            }
+            values.resize(size);
+            for (T& value : values) {
+                visitFields(value, *this);
+            }
+        }
+    } reader_t;
+
+    bool ymlStamp(const char* ymlPath, uint64_t* size, uint64_t* writeTime) {
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if (!GetFileAttributesExA(ymlPath, GetFileExInfoStandard, &data)) {
+            return false;
+        }
+        *size = (uint64_t)data.nFileSizeHigh << 32 | data.nFileSizeLow;
+        *writeTime = (uint64_t)data.ftLastWriteTime.dwHighDateTime << 32 | data.ftLastWriteTime.dwLowDateTime;
+        return true;
+    }
+
+    bool readCache(const char* cachePath, uint64_t ymlSize, uint64_t ymlWriteTime, yml_t* yml) {
+        std::ifstream file(cachePath, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        reader_t reader{ data.data(), data.data() + data.size() };
+        cacheHeader_t header{};
+        reader(header);
+        if (!reader.ok || header.magic != cacheMagic || header.version != cacheVersion
+            || header.ymlSize != ymlSize || header.ymlWriteTime != ymlWriteTime) {
+            return false;
+        }
+        yml_t loaded{};
+        visitFields(loaded, reader);
+        if (!reader.ok || reader.current != reader.end) {
+            return false;
+        }
+        *yml = std::move(loaded);
+        return true;
+    }
+
+    void writeCache(const char* cachePath, uint64_t ymlSize, uint64_t ymlWriteTime, yml_t& yml) {
+        writer_t writer;
+        writer(cacheHeader_t{ cacheMagic, cacheVersion, ymlSize, ymlWriteTime });
+        visitFields(yml, writer);
+        std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+        file.write((const char*)writer.data.data(), writer.data.size());
+    }
+
+    void parseYaml(const char* ymlPath, yml_t* yml) {
+        YAML::Node config = YAML::LoadFile(ymlPath);
+
+        yml->name = config["name"].as<std::string>();
+
+        yml->masterEnable = config["masterEnable"].as<bool>();
+
+        yml->resolution.width = config["resolution"]["width"].as<int>();
+        yml->resolution.height = config["resolution"]["height"].as<int>();
+
+        yml->fix.centerHud.enable = config["fixes"]["centerHud"]["enable"].as<bool>();
+
+        // Optional, older yml files do not have it
+        yml->timeline.csv = config["timeline"]["csv"].as<bool>(false);
+        yml->frametime.enable = config["frametime"]["enable"].as<bool>(false);
+        yml->frameLimiter.enable = config["frameLimiter"]["enable"].as<bool>(false);
+        yml->frameLimiter.fps = config["frameLimiter"]["fps"].as<int>(60);
+        yml->frameLimiter.mode = config["frameLimiter"]["mode"].as<std::string>("pacing");
+        yml->renderScale.enable = config["renderScale"]["enable"].as<bool>(false);
+        yml->renderScale.scale = config["renderScale"]["scale"].as<float>(1.0f);
+        yml->renderScale.dynamic = config["renderScale"]["dynamic"].as<bool>(false);
+        yml->renderScale.targetFps = config["renderScale"]["targetFps"].as<int>(60);
+        yml->retarget.csv = config["retarget"]["csv"].as<bool>(false);
+        for (const YAML::Node& node : config["retarget"]["rules"]) {
+            retargetRule_t rule{};
+            rule.value = node["value"].as<int>();
+            rule.kind = node["kind"].as<std::string>("any");
+            rule.use = node["use"].as<std::string>("any");
+            rule.rva = node["rva"].as<uint32_t>(0);
+            rule.to = node["to"].as<std::string>();
+            yml->retarget.rules.push_back(rule);
+        }
+        yml->overlay.enable = config["overlay"]["enable"].as<bool>(false);
+        yml->log.level = config["log"]["level"].as<std::string>("info");
+    }
+}
+
+namespace Config
+{
+    constants_t computeConstants(const resolution_t& resolution) {
+        constants_t constants{};
+        constants.width = (float)resolution.width;
+        constants.height = (float)resolution.height;
+        constants.defaultWidth = (constants.height * 16.0f) / 9.0f; // 16:9'erizes yml provided width
+        constants.pixelScaler = 77.0f * (constants.width / constants.defaultWidth);
+        constants.centerOffset = (constants.width - constants.defaultWidth) / 2.0f;
+        constants.minimapLeft = ((164.0f - constants.pixelScaler) * 2.0f) + constants.centerOffset;
+        constants.minimapRight = ((164.0f + constants.pixelScaler) * 2.0f) + constants.centerOffset;
+        constants.uiScale = constants.width;
+        constants.viewportScale = constants.width / 2.0f;
+        constants.uiOffset = (constants.width - 1280.0f) / 2.0f;
+        constants.uiScaleRatio = constants.width / 1280.0f;
+        return constants;
+    }
+
+    hot_t makeHot(const yml_t& yml, const constants_t& constants) {
+        hot_t hot{};
+        hot.constants = constants;
+        hot.frametime = yml.masterEnable & yml.frametime.enable;
+        hot.frameLimiter = yml.masterEnable & yml.frameLimiter.enable & (yml.frameLimiter.fps > 0);
+        hot.latency = yml.frameLimiter.mode == "latency";
+        hot.renderScale = yml.masterEnable & yml.renderScale.enable;
+        hot.dynamicScale = yml.renderScale.dynamic;
+        hot.fps = yml.frameLimiter.fps;
+        hot.scale = yml.renderScale.scale;
+        hot.targetFps = yml.renderScale.targetFps;
+        hot.overlay = yml.masterEnable & yml.overlay.enable;
+        return hot;
+    }
+
+    source_t load(const char* ymlPath, const char* cachePath, yml_t* yml) {
+        uint64_t ymlSize = 0;
+        uint64_t ymlWriteTime = 0;
+        bool stamped = cachePath && ymlStamp(ymlPath, &ymlSize, &ymlWriteTime);
+        if (stamped && readCache(cachePath, ymlSize, ymlWriteTime, yml)) {
+            return source_t::Cache;
+        }
+        parseYaml(ymlPath, yml);
+        if (stamped) {
+            writeCache(cachePath, ymlSize, ymlWriteTime, *yml);
+        }
+        return source_t::Yaml;
+    }
+}
@@ -102,52 +102,83 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <format>
 #include <filesystem>
 #include <numeric>
 #include <numbers>
 #include <cmath>
 #include <cstdint>
 #include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <bit>
 
 // 3rd party includes
 #include "spdlog/spdlog.h"
 #include "spdlog/sinks/basic_file_sink.h"
+#include "spdlog/async.h"
 #include "yaml-cpp/yaml.h"
 #include "safetyhook.hpp"
 
 // Local includes
 #include "utils.hpp"
+#include "timeline.hpp"
+#include "config.hpp"
+#include "hook.hpp"
+#include "profiler.hpp"
+#include "events.hpp"
+#include "render.hpp"
+#include "framestats.hpp"
+#include "limiter.hpp"
+#include "scaler.hpp"
+#include "registry.hpp"
+#include "watcher.hpp"
+#include "snapshot.hpp"
+#include "resolver.hpp"
+#include "retarget.hpp"
+#include "overlay.hpp"
+#include "fixes.hpp"
+#include "trace.hpp"
+#include "signatures.hpp"
 
 // Macros
 #define VERSION "1.0.1"
-#define LOG(STRING, ...) spdlog::info("{} : " STRING, __func__, ##__VA_ARGS__)
-
-// .yml to struct
-typedef struct resolution_t {
-    int width;
-    int height;
-    float aspectRatio;
-} resolution_t;
-
-typedef struct centerHud_t {
-    bool enable;
-} textures_t;
-
-typedef struct fix_t {
-    centerHud_t centerHud;
-} fix_t;
-
-typedef struct yml_t {
-    std::string name;
-    bool masterEnable;
-    resolution_t resolution;
-    fix_t fix;
-} yml_t;
+// Arguments are only evaluated when info is enabled
+#define LOG(STRING, ...) \
+    do { \
+        if (spdlog::default_logger_raw()->should_log(spdlog::level::info)) { \
+            spdlog::info("{} : " STRING, __func__, ##__VA_ARGS__); \
+        } \
+    } while (0)
 
 // Globals
-HMODULE baseModule = GetModuleHandle(NULL);
-YAML::Node config = YAML::LoadFile("ValkyriaChroniclesFix.yml");
-yml_t yml;
+HMODULE baseModule;
+yml_t yml;                              // Startup only until `Main` starts the watcher, then the watcher thread owns it
+Snapshot<hot_t> hot;                    // Only what hooks and render callbacks read, see `hot_t`
+std::vector<std::vector<uint64_t>> signatureHits;
+std::once_flag initFlag;
+bool initOk = false;
+bool initEarly = false;                 // `init()` ran from the entry hook, ahead of the game's init code
+HANDLE initEvent;
+constexpr size_t hookPatchSize = 5 + 15 - 1;  // jmp rel32 plus the rest of the longest instruction it can split
+constexpr DWORD entryHookTimeout = 1000;    // ms `Main` waits for the entry hook before running `init()` itself
+void** entryHookSlot = nullptr;
+decltype(&GetSystemTimeAsFileTime) getSystemTimeAsFileTime = nullptr;
+std::filesystem::path ymlPath;          // Absolute, the working directory may change after startup
+bool frameTimeHooked = false;           // The render fixes registered their callbacks at startup
+bool frameLimiterHooked = false;
+bool renderScaleHooked = false;
+bool overlayHooked = false;
+HANDLE deviceEvent;                     // Set once the game created its device
+std::atomic<IDirect3DDevice9*> gameDevice = nullptr;
+bool watchingDevice = false;            // `deviceCreated` is going to be called
+constexpr DWORD deviceTimeout = 10000;  // ms `Main` waits for the game's device before installing the hooks anyway
+constexpr int freezeAttempts = 10;      // Times `installHooks` tries to freeze the game before leaving the hooks out
+constexpr DWORD freezeRetryMs = 50;     // ms between two of them
+extern const std::vector<Registry::entry_t> fixes;  // The fix registry, defined after the fixes
+void publishFixStates();
 
 /**
  * @brief Initializes logging for the application.
@@ -160,10 +191,14 @@ yml_t yml;
  * @return void
  */
 void logInit() {
-    // spdlog initialisation
-    auto logger = spdlog::basic_logger_mt("ValkyriaChroniclesFix", "ValkyriaChroniclesFix.log", true);
+    // spdlog initialisation, the file is written from a background thread and a full queue drops
+    // the oldest message instead of blocking the caller. The queue is guarded by a mutex, it is not
+    // lock-free, so nothing may log while its lock could be held, e.g. with other threads suspended
+    spdlog::init_thread_pool(8192, 1);
+    auto logger = spdlog::create_async_nb<spdlog::sinks::basic_file_sink_mt>("ValkyriaChroniclesFix", "ValkyriaChroniclesFix.log", true);
     spdlog::set_default_logger(logger);
-    spdlog::flush_on(spdlog::level::debug);
+    spdlog::flush_on(spdlog::level::warn);
+    spdlog::flush_every(std::chrono::seconds(1));
 
     // Get game name and exe path
     WCHAR exePath[_MAX_PATH] = { 0 };
@@ -181,25 +216,47 @@ void logInit() {
     LOG("Module Addr: 0x{:x}", (uintptr_t)baseModule);
 }
 
+/**
+ * @brief Sets the level of the logger from the name in the yml.
+ *
+ * @details
+ * `spdlog::level::from_str` turns every name it does not know into `off`, so a typo would hide
+ * the whole log without a word. A name that is not a level keeps `info` and is warned about.
+ *
+ * @param name One of trace, debug, info, warn, err, critical or off.
+ * @return void
+ */
+void setLogLevel(const std::string& name) {
+    spdlog::level::level_enum level = spdlog::level::from_str(name);
+    if (level == spdlog::level::off && name != "off") {
+        spdlog::set_level(spdlog::level::info);
+        spdlog::warn("{} : Log level '{}' is not one of trace, debug, info, warn, err, critical or off, using info", __func__, name);
+        return;
+    }
+    spdlog::set_level(level);
+}
+
 /**
  * @brief Reads and parses configuration settings from a YAML file.
  *
  * This function performs the following tasks:
- * 1. Reads general settings from the configuration file and assigns them to the `yml` structure.
+ * 1. Loads the settings into the `yml` structure, from the binary copy written by the previous
+ *    launch if ValkyriaChroniclesFix.yml has not changed since, otherwise from the yml file.
  * 2. Initializes global settings if certain values are missing or default.
  * 3. Logs the parsed configuration values for debugging purposes.
  *
- * @return void
+ * @return true if the configuration was loaded, false if the yml file could not be parsed.
  */
-void readYml() {
-    yml.name = config["name"].as<std::string>();
-
-    yml.masterEnable = config["masterEnable"].as<bool>();
-
-    yml.resolution.width = config["resolution"]["width"].as<int>();
-    yml.resolution.height = config["resolution"]["height"].as<int>();
-
-    yml.fix.centerHud.enable = config["fixes"]["centerHud"]["enable"].as<bool>();
+bool readYml() {
+    Config::source_t source;
+    try {
+        source = Config::load("ValkyriaChroniclesFix.yml", "ValkyriaChroniclesFix.yml.cache", &yml);
+    } catch (const YAML::Exception& e) {
+        spdlog::error("{} : ValkyriaChroniclesFix.yml could not be read: {}", __func__, e.what());
+        return false;
+    }
+    LOG("Loaded from {}", source == Config::source_t::Cache ? "ValkyriaChroniclesFix.yml.cache" : "ValkyriaChroniclesFix.yml");
+    ymlPath = std::filesystem::absolute("ValkyriaChroniclesFix.yml");
 
     if (yml.resolution.width == 0 || yml.resolution.height == 0) {
         std::pair<int, int> dimensions = Utils::GetDesktopDimensions();
@@ -207,6 +264,11 @@ void readYml() {
         yml.resolution.height = dimensions.second;
     }
     yml.resolution.aspectRatio = (float)yml.resolution.width / (float)yml.resolution.height;
+#ifdef TRACE_HOOKS
+    Trace::setResolution(yml.resolution.width, yml.resolution.height);
+#endif
+    hot.publish(Config::makeHot(yml, Config::computeConstants(yml.resolution)));
+    const constants_t& constants = hot.read().constants;
 
     LOG("Name: {}", yml.name);
     LOG("MasterEnable: {}", yml.masterEnable);
@@ -214,21 +276,214 @@ void readYml() {
     LOG("Resolution.Height: {}", yml.resolution.height);
     LOG("Resolution.AspectRatio: {}", yml.resolution.aspectRatio);
     LOG("Fix.CenterHud.Enable: {}", yml.fix.centerHud.enable);
+    LOG("Timeline.Csv: {}", yml.timeline.csv);
+    LOG("Frametime.Enable: {}", yml.frametime.enable);
+    LOG("FrameLimiter.Enable: {}", yml.frameLimiter.enable);
+    LOG("FrameLimiter.Fps: {}", yml.frameLimiter.fps);
+    LOG("FrameLimiter.Mode: {}", yml.frameLimiter.mode);
+    LOG("RenderScale.Enable: {}", yml.renderScale.enable);
+    LOG("RenderScale.Scale: {}", yml.renderScale.scale);
+    LOG("RenderScale.Dynamic: {}", yml.renderScale.dynamic);
+    LOG("RenderScale.TargetFps: {}", yml.renderScale.targetFps);
+    LOG("Retarget.Csv: {}", yml.retarget.csv);
+    LOG("Retarget.Rules: {}", yml.retarget.rules.size());
+    LOG("Overlay.Enable: {}", yml.overlay.enable);
+    LOG("Log.Level: {}", yml.log.level);
+    LOG("Constants: defaultWidth {} pixelScaler {} centerOffset {} minimap {}..{}", constants.defaultWidth,
+        constants.pixelScaler, constants.centerOffset, constants.minimapLeft, constants.minimapRight);
+    setLogLevel(yml.log.level);
+    return true;
 }
 
 /**
- * @brief Centers player and enemy UI icons correctly.
+ * @brief Applies changes to ValkyriaChroniclesFix.yml while the game is running.
  *
  * This function performs the following tasks:
- * 1. Checks if the master enable is enabled based on the configuration.
- * 2. Searches for a specific memory pattern in the base module.
- * 3. Hooks at the identified pattern to inject a new value into the esp + 0xC.
+ * 1. Loads the yml again, a file that can not be parsed leaves everything as it is.
+ * 2. Takes over every setting that can change at runtime and publishes a new `hot` snapshot,
+ *    the render callbacks pick it up on their next frame.
+ * 3. Switches the hooks of the fix registry to match and publishes their states for the overlay.
+ * 4. Warns about every other change, those need a restart. So does enabling a hook that was never
+ *    installed, that is only safe with the game frozen like in `installHooks()`.
  *
  * @details
- * The function uses a pattern scan to find a specific byte sequence in the memory of the base module.
- * If the pattern is found, a hook is created at an offset from the found pattern address. The hook
- * injects a new value into the esp + 0xC.
+ * Runs on the watcher thread, which owns `yml`, `initFixes` and `frozenFixes` once the hooks are
+ * installed, the render thread only reads `hot` and `fixStates`. The game sizes its buffers from
+ * the resolution once during its init, so the resolution and everything derived from it stays as it
+ * was at startup. The frame time recorder, the frame limiter, render scaling and the overlay can be
+ * tuned and switched off and on again, but the device functions they need are only hooked if they
+ * were enabled at startup.
  *
+ * @return void
+ */
+void reloadYml() {
+    yml_t next;
+    try {
+        Config::load(ymlPath.string().c_str(), (ymlPath.string() + ".cache").c_str(), &next);
+    } catch (const YAML::Exception& e) {
+        spdlog::error("{} : ValkyriaChroniclesFix.yml could not be read, keeping the current settings: {}", __func__, e.what());
+        return;
+    }
+    if (next.resolution.width == 0 || next.resolution.height == 0) {
+        std::pair<int, int> dimensions = Utils::GetDesktopDimensions();
+        next.resolution.width  = dimensions.first;
+        next.resolution.height = dimensions.second;
+    }
+    next.resolution.aspectRatio = yml.resolution.aspectRatio;
+
+    std::string restart;
+    auto needsRestart = [&restart](bool changed, const std::string& name) {
+        if (changed) {
+            restart += restart.empty() ? name : std::string(", ") + name;
+        }
+    };
+    needsRestart(next.resolution.width != yml.resolution.width || next.resolution.height != yml.resolution.height, "resolution");
+    needsRestart(next.timeline != yml.timeline, "timeline");
+    needsRestart(next.retarget != yml.retarget, "retarget");
+    needsRestart(next.masterEnable & next.frametime.enable & !frameTimeHooked, "enabling frametime");
+    needsRestart(next.masterEnable & next.frameLimiter.enable & !frameLimiterHooked, "enabling frameLimiter");
+    needsRestart(next.masterEnable & next.renderScale.enable & !renderScaleHooked, "enabling renderScale");
+    needsRestart(next.masterEnable & next.overlay.enable & !overlayHooked, "enabling overlay");
+
+    LOG("MasterEnable: {} -> {}", yml.masterEnable, next.masterEnable);
+    LOG("Fix.CenterHud.Enable: {} -> {}", yml.fix.centerHud.enable, next.fix.centerHud.enable);
+    LOG("Frametime.Enable: {} -> {}", yml.frametime.enable, next.frametime.enable);
+    LOG("FrameLimiter: {} {} fps {} -> {} {} fps {}", yml.frameLimiter.enable, yml.frameLimiter.fps, yml.frameLimiter.mode,
+        next.frameLimiter.enable, next.frameLimiter.fps, next.frameLimiter.mode);
+    LOG("RenderScale: {} {} {} {} fps -> {} {} {} {} fps", yml.renderScale.enable, yml.renderScale.scale, yml.renderScale.dynamic,
+        yml.renderScale.targetFps, next.renderScale.enable, next.renderScale.scale, next.renderScale.dynamic, next.renderScale.targetFps);
+    LOG("Overlay.Enable: {} -> {}", yml.overlay.enable, next.overlay.enable);
+    LOG("Log.Level: {} -> {}", yml.log.level, next.log.level);
+    next.resolution = yml.resolution;
+    next.timeline = yml.timeline;
+    next.retarget = yml.retarget;
+    yml = next;
+    hot.publish(Config::makeHot(yml, hot.read().constants));
+    setLogLevel(yml.log.level);
+    std::vector<const Registry::entry_t*> notInstalled;
+    for (const Registry::result_t& result : Registry::update(signatureHits, frozenFixes, &notInstalled)) {
+        logFix(result);
+    }
+    publishFixStates();
+    for (const Registry::entry_t* entry : notInstalled) {
+        needsRestart(true, std::string("enabling ") + entry->name);
+    }
+    if (!restart.empty()) {
+        spdlog::warn("{} : Changes to {} apply on the next launch", __func__, restart);
+    }
+}
+
+/**
+ * @brief Worker threads for the startup scans, half of the cores are left to the game since it
+ * is loading at the same time.
+ *
+ * @return Between 1 and `Utils::maxScanThreads`.
+ */
+unsigned scanThreads() {
+    return std::clamp(std::thread::hardware_concurrency() / 2, 1u, Utils::maxScanThreads);
+}
+
+/**
+ * @brief Resolves every fix signature of the signature database at once.
+ *
+ * This function performs the following tasks:
+ * 1. Verifies the offsets cached in ValkyriaChroniclesFix.cache from a previous launch.
+ * 2. If the executable changed, walks its executable sections a single time looking for every
+ *    candidate in `signatureDatabase`, split over a few worker threads, and rewrites the cache.
+ * 3. Picks the candidate that resolved uniquely for every signature and stores its hits in
+ *    `signatureHits` for the fixes to pick up.
+ * 4. Drops the hits of a signature that did not resolve uniquely when any fix using it writes
+ *    code there, the closest candidate could be any instruction that happens to look alike.
+ *    Only a signature nothing writes at keeps them.
+ *
+ * @return void
+ */
+void scanSignatures() {
+    unsigned threads = scanThreads();
+    bool cacheHit = false;
+    std::vector<resolved_t> resolved = resolveSignatures(baseModule, &signatureHits, "ValkyriaChroniclesFix.cache", threads, &cacheHit);
+    LOG("Offset cache {}", cacheHit ? "hit" : "miss, rescanned");
+    for (size_t i = 0; i < resolved.size(); i++) {
+        const candidate_t* candidate = resolved[i].candidate;
+        if (!candidate) {
+            LOG("'{}' : no candidate found", signatureDatabase[i][0].signature.pattern.text);
+        }
+        else if (resolved[i].unique) {
+            LOG("'{}' : {} hit(s), candidate {} of {} ({})", candidate->signature.pattern.text, resolved[i].hits,
+                resolved[i].index + 1, signatureDatabase[i].size(), candidate->note);
+        }
+        else if (Registry::writesCode(fixes, (signatureId_t)i)) {
+            signatureHits[i].clear();
+            spdlog::warn("{} : '{}' : {} hit(s) where {} were expected, candidate {} of {} ({}), rejected as a fix writes code there", __func__,
+                candidate->signature.pattern.text, resolved[i].hits, candidate->expectedHits,
+                resolved[i].index + 1, signatureDatabase[i].size(), candidate->note);
+        }
+        else {
+            spdlog::warn("{} : '{}' : {} hit(s) where {} were expected, candidate {} of {} ({}), using the first", __func__,
+                candidate->signature.pattern.text, resolved[i].hits, candidate->expectedHits,
+                resolved[i].index + 1, signatureDatabase[i].size(), candidate->note);
+        }
+    }
+}
+
+/**
+ * @brief Hardcodes the resolution the game derives its render size from.
+ *
+ * Overwrites the math the game does on the desktop resolution with the values from `readYml()`.
+ *
+ * @details
+ * This used to be done by ValkyriaChroniclesPatch.py on the exe on disk, the code runs very early
+ * in the game's init so the patch has to be applied from `init()` before `WinMain` is reached.
+ * ValkyriaChroniclesPatch.exe can still write the same bytes to the exe on disk, which this fix
+ * then recognizes and patches again.
+ * The code we replace:
+ * B8 39 8E E3 38 | mov eax,38E38E39 |
+ * F7 E3          | mul ebx          |
+ * 8B FA          | mov edi, edx     |
+ * B8 39 8E E3 38 | mov eax,38E38E39 |
+ * F7 EB          | imul ebx         |
+ * D1 FA          | sar edx, 1       |
+ * 8B C2          | mov eax, edx     |
+ * C1 E8 1F       | shr eax, 1F      |
+ * 03 C2          | add eax, edx     |
+ * 2B C8          | sub ecx, eax     |
+ * D1 EF          | shr edi, 1       |
+ * D1 F9          | sar ecx, 1       |
+ * We replace it with, assuming 5120x1440 resolution:
+ * B8 00 14 00 00  | mov eax, 0x1400 | eax = 5120      | Width provided in yml
+ * BB 00 5A 00 00  | mov ebx, 0x5A00 | ebx = 1440 << 4 | Height provided in yml shifted by 4 to the left
+ * B9 00 00 00 00  | mov ecx, 0x0    | ecx = 0         | Viewport offset, centers image if width in yml > screen
+ * BA 00 14 00 00  | mov edx, 0x1400 | edx = 5120      | Width provided in yml
+ * BE A0 05 00 00  | mov esi, 0x5A0  | esi = 1440      | Height provided in yml
+ * BF 00 14 00 00  | mov edi, 0x1400 | edi = 5120      | Width provided in yml
+ * 90              | nop             |                 | padding
+ *
+ * @param address Where the registry found it.
+ * @return true if applied.
+ */
+bool resolutionFix(uintptr_t address) {
+    uintptr_t relAddr = address - (uintptr_t)baseModule;
+    std::pair<int, int> desktop = Utils::GetDesktopDimensions();
+    uint32_t width = (uint32_t)yml.resolution.width;
+    uint32_t height = (uint32_t)yml.resolution.height;
+    uint32_t offset = (uint32_t)((desktop.first - yml.resolution.width) / 2);
+
+    std::vector<uint8_t> code = resolutionPatch(width, height, offset);
+    static Utils::PatchTransaction resolutionPatch;
+    resolutionPatch.add(address, code.data(), code.size());
+    bool ok = resolutionPatch.commit();
+    if (ok) {
+        LOG("Patched '{}' @ 0x{:x}", Utils::bytesToString(code.data(), code.size()), relAddr);
+    }
+    return ok;
+}
+
+/**
+ * @brief Centers player and enemy UI icons correctly.
+ *
+ * Hooks at the address of its registry entry to inject a new value into the esp + 0xC.
+ *
+ * @details
  * How was this found?
  * This is another case of things being offset incorrectly. Given our values during initialization,
  * the value that the game would use is 2560.0f. This is wrong. We need to go back to the default
@@ -239,51 +494,30 @@ void readYml() {
  * monitor, but this is not desirable. We need to scale back! So we inject back in 1280.0f. Now the
  * game in its infinite wisdom is able to scale things properly.
  *
- * @return void
+ * @param address Where the registry found it.
+ * @return true if applied.
  */
-void centerUiIconsFix() {
-    const char* patternFind = "D9 46 64    D9 5C 24 1C    D9 46 68    D9 5C 24 14    D9 46 6C";
-    uintptr_t  hookOffset = 0;
-
-    bool enable = yml.masterEnable & yml.fix.centerHud.enable;
-    LOG("Fix {}", enable ? "Enabled" : "Disabled");
-    if (enable) {
-        std::vector<uint64_t> addr;
-        Utils::patternScan(baseModule, patternFind, &addr);
-        uint8_t* hit = (uint8_t*)addr[0];
-        uintptr_t absAddr = (uintptr_t)hit;
-        uintptr_t relAddr = (uintptr_t)hit - (uintptr_t)baseModule;
-        if (hit) {
-            LOG("Found '{}' @ 0x{:x}", patternFind, relAddr);
-            uintptr_t hookAbsAddr = absAddr + hookOffset;
-            uintptr_t hookRelAddr = relAddr + hookOffset;
-            static SafetyHookMid centerUiIconsHook{};
-            centerUiIconsHook = safetyhook::create_mid(reinterpret_cast<void*>(hookAbsAddr),
-                [](SafetyHookContext& ctx) {
-                    *((float*)(ctx.esp + 0xC)) = 1280.0f;
-                }
-            );
-            LOG("Hooked @ 0x{:x} + 0x{:x} = 0x{:x}", relAddr, hookOffset, hookRelAddr);
-        }
-        else {
-            LOG("Did not find '{}'", patternFind);
+std::vector<Hook::store_t> centerUiIconsStores;
+Hook::Store centerUiIconsHook;
+bool centerUiIconsFix(uintptr_t address) {
+    centerUiIconsStores = Fixes::centerUiIcons();
+    bool ok = centerUiIconsHook.create(reinterpret_cast<void*>(address), centerUiIconsStores,
+        [](SafetyHookContext& ctx) {
+            PROFILE_HOOK("centerUiIcons");
+            TRACE_HOOK("centerUiIcons", ctx, centerUiIconsStores);
+            RECORD_EVENT("centerUiIcons", (uint32_t)ctx.esp);
+            Hook::apply(centerUiIconsStores, ctx);
         }
-    }
+    );
+    return ok;
 }
 
 /**
  * @brief Fixes the minimap overlay so icons are on the map and scale properly.
  *
- * This function performs the following tasks:
- * 1. Checks if the master enable is enabled based on the configuration.
- * 2. Searches for a specific memory pattern in the base module.
- * 3. Hooks at the identified pattern to inject a new value into the eax + 0x90 and + 0x98.
+ * Hooks at the address of its registry entry to inject a new value into the eax + 0x90 and + 0x98.
  *
  * @details
- * The function uses a pattern scan to find a specific byte sequence in the memory of the base module.
- * If the pattern is found, a hook is created at an offset from the found pattern address. The hook
- * injects a new value into the eax + 0x90 and + 0x98.
- *
  * How was this found?
  * This was found by complete accident by playing around with a random scaler value 2.0f if 5120.0f
  * and it was observed that changed this scaler value would scale the minimap overlay, not correctly
@@ -313,57 +547,33 @@ void centerUiIconsFix() {
  * leave it as is the overlay will be a bit squished and not fit perfectly onto the map. So regardless of
  * X resolution, we do: (77.0f * (xResolution / 2560.0f))
  * If xResolution is 5120 then we get 154.0f, if xResolution is 3440 then we get 103.46875f, and so on.
+ * Both final X values only depend on the resolution, so they are taken from `hot_t::constants` and the hook
+ * is just the two stores.
  *
- * @return void
+ * @param address Where the registry found it.
+ * @return true if applied.
  */
-void minimapOverlayFix() {
-    const char* patternFind = "DE C1    DE C9    D9 98 9C 00 00 00";
-    uintptr_t  hookOffset = 0;
-
-    bool enable = yml.masterEnable & yml.fix.centerHud.enable;
-    LOG("Fix {}", enable ? "Enabled" : "Disabled");
-    if (enable) {
-        std::vector<uint64_t> addr;
-        Utils::patternScan(baseModule, patternFind, &addr);
-        uint8_t* hit = (uint8_t*)addr[0];
-        uintptr_t absAddr = (uintptr_t)hit;
-        uintptr_t relAddr = (uintptr_t)hit - (uintptr_t)baseModule;
-        if (hit) {
-            LOG("Found '{}' @ 0x{:x}", patternFind, relAddr);
-            uintptr_t hookAbsAddr = absAddr + hookOffset;
-            uintptr_t hookRelAddr = relAddr + hookOffset;
-            static SafetyHookMid minimapOverlayHook{};
-            minimapOverlayHook = safetyhook::create_mid(reinterpret_cast<void*>(hookAbsAddr),
-                [](SafetyHookContext& ctx) {
-                    float width = static_cast<float>(yml.resolution.width);
-                    float height = static_cast<float>(yml.resolution.height);
-                    float defaultWidth = (height * 16.0f) / 9.0f; // 16:9'erizes yml provided width
-                    float pixelScaler = (77.0f * (width / defaultWidth));
-                    *((float*)(ctx.eax + 0x90)) = ((164.0f - pixelScaler) * 2.0f) + ((width - defaultWidth) / 2.0f);
-                    *((float*)(ctx.eax + 0x98)) = ((164.0f + pixelScaler) * 2.0f) + ((width - defaultWidth) / 2.0f);
-                }
-            );
-            LOG("Hooked @ 0x{:x} + 0x{:x} = 0x{:x}", relAddr, hookOffset, hookRelAddr);
-        }
-        else {
-            LOG("Did not find '{}'", patternFind);
+std::vector<Hook::store_t> minimapOverlayStores;
+Hook::Store minimapOverlayHook;
+bool minimapOverlayFix(uintptr_t address) {
+    minimapOverlayStores = Fixes::minimapOverlay(hot.read().constants);
+    bool ok = minimapOverlayHook.create(reinterpret_cast<void*>(address), minimapOverlayStores,
+        [](SafetyHookContext& ctx) {
+            PROFILE_HOOK("minimapOverlay");
+            TRACE_HOOK("minimapOverlay", ctx, minimapOverlayStores);
+            RECORD_EVENT("minimapOverlay", (uint32_t)ctx.eax);
+            Hook::apply(minimapOverlayStores, ctx);
         }
-    }
+    );
+    return ok;
 }
 
 /**
  * @brief Fixes the textbox backgrounds that are missing when resolution becomes > 16:9.
  *
- * This function performs the following tasks:
- * 1. Checks if the master enable is enabled based on the configuration.
- * 2. Searches for a specific memory pattern in the base module.
- * 3. Hooks at the identified pattern to inject a new value into the ebp - 0x8.
+ * Hooks at the address of its registry entry to inject a new value into the ebp - 0x8.
  *
  * @details
- * The function uses a pattern scan to find a specific byte sequence in the memory of the base module.
- * If the pattern is found, a hook is created at an offset from the found pattern address. The hook
- * injects a new value into the ebp - 0x8.
- *
  * How was this found?
  * This goes back to the game once again using the magi c number 1280.0f to determine where to fit certain
  * things. When going beyond 32:9 the calculation below would have been 5120.0f / 2.0f. Which would be
@@ -374,53 +584,31 @@ void minimapOverlayFix() {
  *
  * It is important to note that on 21:9 this anomaly does not seem to be observed.
  *
- * @return void
+ * @param address Where the registry found it.
+ * @return true if applied.
  */
-void textboxFix() {
-    const char* patternFind = "D9 5D F8    A8 04    74 0E";
-    uintptr_t  hookOffset = 3;
-
-    // This needs to be always on regardless of enabling of other fixes
-    bool enable = yml.masterEnable;
-    LOG("Fix {}", enable ? "Enabled" : "Disabled");
-    if (enable) {
-        std::vector<uint64_t> addr;
-        Utils::patternScan(baseModule, patternFind, &addr);
-        uint8_t* hit = (uint8_t*)addr[0];
-        uintptr_t absAddr = (uintptr_t)hit;
-        uintptr_t relAddr = (uintptr_t)hit - (uintptr_t)baseModule;
-        if (hit) {
-            LOG("Found '{}' @ 0x{:x}", patternFind, relAddr);
-            uintptr_t hookAbsAddr = absAddr + hookOffset;
-            uintptr_t hookRelAddr = relAddr + hookOffset;
-            static SafetyHookMid textboxHook{};
-            textboxHook = safetyhook::create_mid(reinterpret_cast<void*>(hookAbsAddr),
-                [](SafetyHookContext& ctx) {
-                    *((float*)(ctx.ebp - 0x8)) = 1280.0f;
-                }
-            );
-            LOG("Hooked @ 0x{:x} + 0x{:x} = 0x{:x}", relAddr, hookOffset, hookRelAddr);
-        }
-        else {
-            LOG("Did not find '{}'", patternFind);
+std::vector<Hook::store_t> textboxStores;
+Hook::Store textboxHook;
+bool textboxFix(uintptr_t address) {
+    textboxStores = Fixes::textbox();
+    bool ok = textboxHook.create(reinterpret_cast<void*>(address), textboxStores,
+        [](SafetyHookContext& ctx) {
+            PROFILE_HOOK("textbox");
+            TRACE_HOOK("textbox", ctx, textboxStores);
+            RECORD_EVENT("textbox", (uint32_t)ctx.ebp);
+            Hook::apply(textboxStores, ctx);
         }
-    }
+    );
+    return ok;
 }
 
 /**
  * @brief Fixes the UI scaling.
  *
- * This function performs the following tasks:
- * 1. Checks if the master enable is enabled based on the configuration.
- * 2. Searches for a specific memory pattern in the base module.
- * 3. Hooks at the identified pattern to inject a new value into the memory location pointed to by
- * `uiScalerAddr` variable.
-
- * @details
- * The function uses a pattern scan to find a specific byte sequence in the memory of the base module.
- * If the pattern is found, a hook is created at an offset from the found pattern address. The hook
- * injects a new value into memory location pointed to by `uiScalerAddr` variable.
+ * Hooks at the address of its registry entry to inject a new value into the memory location pointed
+ * to by `uiScalerAddr` variable, the memory operand of the `fld` there as decoded by `Resolver`.
  *
+ * @details
  * How was this found?
  * First navigate to the top and read over the documentation going over the structs that handle in game
  * initialization at the very start, way before a window is even created. 5. is the relevant data necessary
@@ -434,61 +622,673 @@ void textboxFix() {
  * and of course this does not center the UI, there is another value that allows it to be centered, but
  * I am not going to be exploring that as it is irrelevent to this fix and should be left alone.
  *
- * @return void
+ * @param address Where the registry found it.
+ * @return true if applied.
  */
 uintptr_t* uiScalerAddr;
-void uiScalingFix() {
-    const char* patternFind = "D9 05 ?? ?? ?? ??    D9 98 88 00 00 00    D9 45 08";
-    uintptr_t  hookOffset = 0;
+std::vector<Hook::store_t> uiScalingStores;
+Hook::Store uiScalingHook;
+bool uiScalingFix(uintptr_t address) {
+    uiScalerAddr = (uintptr_t*)Resolver::resolve(baseModule, address).memory;
+    if (!uiScalerAddr) {
+        return false;
+    }
+    uiScalingStores = Fixes::uiScaling((uintptr_t)uiScalerAddr);
+    bool ok = uiScalingHook.create(reinterpret_cast<void*>(address), uiScalingStores,
+        [](SafetyHookContext& ctx) {
+            PROFILE_HOOK("uiScaling");
+            TRACE_HOOK("uiScaling", ctx, uiScalingStores);
+            RECORD_EVENT("uiScaling", (uint32_t)(uintptr_t)uiScalerAddr);
+            Hook::apply(uiScalingStores, ctx);
+        }
+    );
+    return ok;
+}
+
+bool masterEnabled() {
+    return yml.masterEnable;
+}
+
+bool centerHudEnabled() {
+    return yml.masterEnable & yml.fix.centerHud.enable;
+}
 
-    bool enable = yml.masterEnable & yml.fix.centerHud.enable;
+// Every fix that patches or hooks the game's code, installed in table order within each phase
+const std::vector<Registry::entry_t> fixes = {
+    // Patches the game's init code, switching it later has no effect
+    { "resolutionFix", ResolutionSignature, 0, 0x1F, Registry::phase_t::Init, masterEnabled, resolutionFix, nullptr,
+        "this build of Valkyria.exe is not supported" },
+    { "centerUiIconsFix", CenterUiIconsSignature, 0, hookPatchSize, Registry::phase_t::Frozen, centerHudEnabled, centerUiIconsFix,
+        [](bool enable) { return centerUiIconsHook.setEnabled(enable); }, nullptr },
+    { "uiScalingFix", UiScalingSignature, 0, hookPatchSize, Registry::phase_t::Frozen, centerHudEnabled, uiScalingFix,
+        [](bool enable) { return uiScalingHook.setEnabled(enable); }, nullptr },
+    { "minimapOverlayFix", MinimapOverlaySignature, 0, hookPatchSize, Registry::phase_t::Frozen, centerHudEnabled, minimapOverlayFix,
+        [](bool enable) { return minimapOverlayHook.setEnabled(enable); }, nullptr },
+    // This needs to be always on regardless of enabling of other fixes
+    { "textboxFix", TextboxSignature, 3, hookPatchSize, Registry::phase_t::Frozen, masterEnabled, textboxFix,
+        [](bool enable) { return textboxHook.setEnabled(enable); }, nullptr },
+};
+std::vector<Registry::result_t> initFixes;
+std::vector<Registry::result_t> frozenFixes;
+
+// What the render thread reads of `initFixes` and `frozenFixes`, both phases in order
+constexpr size_t maxFixStates = 16;
+typedef struct fixStates_t {
+    size_t count;
+    Registry::result_t results[maxFixStates];
+} fixStates_t;
+Snapshot<fixStates_t> fixStates;
+
+/**
+ * @brief Publishes the current results of the registry for the overlay.
+ *
+ * @return void
+ */
+void publishFixStates() {
+    fixStates_t states{};
+    for (const std::vector<Registry::result_t>* results : { &initFixes, &frozenFixes }) {
+        for (const Registry::result_t& result : *results) {
+            if (states.count < maxFixStates) {
+                states.results[states.count++] = result;
+            }
+        }
+    }
+    fixStates.publish(states);
+}
+
+/**
+ * @brief The `Hook::Store` an entry installs, for the log.
+ *
+ * @param entry Entry of the registry.
+ * @return nullptr if the entry is not a hook.
+ */
+const Hook::Store* entryHook(const Registry::entry_t& entry) {
+    if (entry.install == centerUiIconsFix) {
+        return &centerUiIconsHook;
+    }
+    if (entry.install == uiScalingFix) {
+        return &uiScalingHook;
+    }
+    if (entry.install == minimapOverlayFix) {
+        return &minimapOverlayHook;
+    }
+    if (entry.install == textboxFix) {
+        return &textboxHook;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Logs how installing or switching one registry entry went.
+ *
+ * @param result Result from the registry.
+ * @return void
+ */
+void logFix(const Registry::result_t& result) {
+    const Registry::entry_t& entry = *result.entry;
+    uintptr_t relAddr = result.address - (uintptr_t)baseModule;
+    switch (result.state) {
+    case Registry::state_t::Disabled:
+        LOG("{} Disabled", entry.name);
+        break;
+    case Registry::state_t::NotFound:
+        LOG("{} Enabled, did not find '{}'{}{}", entry.name, signatureDatabase[entry.signature][0].signature.pattern.text,
+            entry.notFound ? ", " : "", entry.notFound ? entry.notFound : "");
+        break;
+    case Registry::state_t::Installed:
+        LOG("{} Enabled, applied @ 0x{:x} ({} hit(s), first + 0x{:x}){}", entry.name, relAddr, result.hits, entry.offset,
+            !entryHook(entry) ? "" : entryHook(entry)->isStub() ? " as a store stub" : " as a mid hook");
+        if (entry.install == uiScalingFix) {
+            LOG("{} UI scaler @ 0x{:x}", entry.name, (uintptr_t)uiScalerAddr);
+        }
+        break;
+    case Registry::state_t::Off:
+        LOG("{} Disabled, switched off @ 0x{:x}", entry.name, relAddr);
+        break;
+    case Registry::state_t::Failed:
+        spdlog::warn("{} : {} Enabled, could not be applied @ 0x{:x}", __func__, entry.name, relAddr);
+        break;
+    }
+}
+
+/**
+ * @brief Logs how installing every entry of a phase went.
+ *
+ * @param results Results of `installFixes()`.
+ * @return void
+ */
+void logFixes(const std::vector<Registry::result_t>& results) {
+    for (const Registry::result_t& result : results) {
+        logFix(result);
+    }
+}
+
+/**
+ * @brief Installs one phase of the fix registry.
+ *
+ * @details
+ * Nothing is logged here or by the fixes, the `Frozen` phase runs with every other thread
+ * suspended and the logger thread may be one of them, holding the lock of its queue. The
+ * results are logged with `logFixes()` once the game runs again.
+ *
+ * @param phase Phase to install.
+ * @return The results, kept for `reloadYml()` to switch the entries later.
+ */
+std::vector<Registry::result_t> installFixes(Registry::phase_t phase) {
+    return Registry::install(fixes, signatureHits, phase);
+}
+
+/**
+ * @brief Rewrites the uses of 1280 and 1920 picked by the retarget rules in the yml.
+ *
+ * This function performs the following tasks:
+ * 1. Skips everything when there is no rule and no CSV to write, the index costs a scan.
+ * 2. Indexes every reference to 1280 and 1920 in the game's code, cached in
+ *    ValkyriaChroniclesFix.constants.cache.
+ * 3. Writes the index to ValkyriaChroniclesFix.constants.csv if asked to, which lists the RVA a
+ *    rule needs to pick a single instruction.
+ * 4. Applies every rule in one patch transaction, code any fix of the registry patches is left to
+ *    the fix.
+ *
+ * @details
+ * Runs before the `Init` phase of the registry so the game's init code, which uses these constants
+ * the most, already sees the new values. Rules can name any value of `constants_t` as their
+ * target, e.g. `to: width`.
+ *
+ * @return void
+ */
+void retargetConstants() {
+    if (!yml.masterEnable || (yml.retarget.rules.empty() && !yml.retarget.csv)) {
+        LOG("Disabled");
+        return;
+    }
+    std::vector<Retarget::reference_t> references;
+    {
+        Timeline::Scope scope("indexConstants");
+        references = Retarget::index(baseModule, "ValkyriaChroniclesFix.constants.cache", scanThreads());
+    }
+    LOG("{} reference(s) to 1280 and 1920", references.size());
+    if (yml.retarget.csv) {
+        bool written = Retarget::writeCsv("ValkyriaChroniclesFix.constants.csv", baseModule, references);
+        LOG("{} ValkyriaChroniclesFix.constants.csv", written ? "Wrote" : "Could not write");
+    }
+    if (yml.retarget.rules.empty()) {
+        return;
+    }
+
+    std::vector<Utils::codeRange_t> avoid = Registry::ranges(fixes, signatureHits, Registry::phase_t::Init);
+    std::vector<Utils::codeRange_t> frozen = Registry::ranges(fixes, signatureHits, Registry::phase_t::Frozen);
+    avoid.insert(avoid.end(), frozen.begin(), frozen.end());
+    bool committed = false;
+    std::vector<Retarget::applied_t> results = Retarget::apply(baseModule, references, yml.retarget.rules,
+        hot.read().constants, avoid, &committed);
+    for (size_t i = 0; i < results.size(); i++) {
+        const retargetRule_t& rule = *results[i].rule;
+        if (!results[i].valid) {
+            spdlog::warn("{} : Rule {} ({} {} {} -> {}) not understood, skipped", __func__, i + 1, rule.value, rule.kind, rule.use, rule.to);
+            continue;
+        }
+        LOG("Rule {} ({} {} {} @ 0x{:x} -> {}) : {} reference(s) retargeted, {} inside fixes left alone", i + 1, rule.value,
+            rule.kind, rule.use, rule.rva, results[i].to, results[i].matched, results[i].skipped);
+    }
+    if (!committed) {
+        spdlog::warn("{} : The retargeted constants could not be written, nothing was changed", __func__);
+    }
+}
+
+/**
+ * @brief One time setup shared by the early entry hook and `Main`, whichever gets there first.
+ *
+ * This function performs the following tasks:
+ * 1. Initializes the logging system.
+ * 2. Reads the configuration from a YAML file.
+ * 3. Scans for the signatures of all fixes in one pass.
+ * 4. Rewrites the constants picked by the retarget rules.
+ * 5. Installs the `Init` phase of the fix registry, the resolution fix has to land before the
+ *    game's init code runs.
+ *
+ * @param source Who called, for the log.
+ * @param early true when called ahead of the game's init code.
+ * @return true if the configuration could be read and the fixes should be applied.
+ */
+bool init(const char* source, bool early) {
+    std::call_once(initFlag, [source, early] {
+        initEarly = early;
+        {
+            Timeline::Scope scope("logInit");
+            logInit();
+        }
+        LOG("Initializing from {}", source);
+        {
+            Timeline::Scope scope("readYml");
+            initOk = readYml();
+        }
+        if (initOk) {
+            {
+                Timeline::Scope scope("scanSignatures");
+                scanSignatures();
+            }
+            {
+                Timeline::Scope scope("retargetConstants");
+                retargetConstants();
+            }
+            initFixes = installFixes(Registry::phase_t::Init);
+            logFixes(initFixes);
+            publishFixStates();
+        }
+    });
+    return initOk;
+}
+
+/**
+ * @brief Stands in for the game's first call to `GetSystemTimeAsFileTime`.
+ *
+ * @details
+ * The CRT startup of the game calls `GetSystemTimeAsFileTime` to seed its stack cookie before
+ * `WinMain` runs, and at that point the image is mapped and its imports are bound. That makes it
+ * the earliest point on the game's main thread where the code can be scanned and patched. The
+ * import slot is restored straight away so every later call goes to kernel32 directly.
+ *
+ * @param systemTime Forwarded to `GetSystemTimeAsFileTime`.
+ * @return void
+ */
+void WINAPI entryHook(LPFILETIME systemTime) {
+    Utils::patch((uintptr_t)entryHookSlot, (const uint8_t*)&getSystemTimeAsFileTime, sizeof(void*));
+    init("the game's CRT startup", true);
+    SetEvent(initEvent);
+    getSystemTimeAsFileTime(systemTime);
+}
+
+/**
+ * @brief Redirects the game's import of `GetSystemTimeAsFileTime` to `entryHook`.
+ *
+ * @details
+ * Only writes one pointer so it is safe to call from `DllMain` under the loader lock, nothing
+ * is loaded, allocated or logged.
+ *
+ * @return true if the game imports `GetSystemTimeAsFileTime` and the slot was redirected.
+ */
+bool installEntryHook() {
+    entryHookSlot = Utils::findImport(GetModuleHandle(NULL), "KERNEL32.dll", "GetSystemTimeAsFileTime");
+    if (!entryHookSlot) {
+        return false;
+    }
+    getSystemTimeAsFileTime = (decltype(&GetSystemTimeAsFileTime))*entryHookSlot;
+    auto hook = &entryHook;
+    Utils::patch((uintptr_t)entryHookSlot, (const uint8_t*)&hook, sizeof(void*));
+    return true;
+}
+
+/**
+ * @brief Called by the render module on the game's thread once the game created its device.
+ *
+ * @details
+ * Marks the point the hooks of the `Frozen` phase wait for, by then the game has its window and
+ * renderer up and is about to load its first screen. Only hands the device over to `Main`, the game
+ * is waiting on it.
+ *
+ * @param device The game's device.
+ * @return void
+ */
+void deviceCreated(IDirect3DDevice9* device) {
+    Timeline::mark("deviceCreated");
+    gameDevice = device;
+    SetEvent(deviceEvent);
+}
+
+/**
+ * @brief Records the time of every presented frame.
+ *
+ * This function performs the following tasks:
+ * 1. Checks if the frame time recorder is enabled based on the configuration.
+ * 2. Timestamps every `Present` into the `FrameStats` ring.
+ * 3. On F10 logs the average, variance and 1%/0.1% lows and writes every frame time to
+ *    ValkyriaChroniclesFix.frametimes.csv, so features can be compared before and after.
+ *
+ * @return void
+ */
+void frameTimeFix() {
+    bool enable = hot.read().frametime;
     LOG("Fix {}", enable ? "Enabled" : "Disabled");
     if (enable) {
-        std::vector<uint64_t> addr;
-        Utils::patternScan(baseModule, patternFind, &addr);
-        uint8_t* hit = (uint8_t*)addr[0];
-        uintptr_t absAddr = (uintptr_t)hit;
-        uintptr_t relAddr = (uintptr_t)hit - (uintptr_t)baseModule;
-        if (hit) {
-            LOG("Found '{}' @ 0x{:x}", patternFind, relAddr);
-            uintptr_t hookAbsAddr = absAddr + hookOffset;
-            uintptr_t hookRelAddr = relAddr + hookOffset;
-            uiScalerAddr = *(uintptr_t**)(hookAbsAddr + 2);
-            LOG("masterStructAddr: 0x{:x}", (uintptr_t)uiScalerAddr);
-            LOG("masterStructAddr: 0x{:x}", (uintptr_t)*uiScalerAddr);
-            static SafetyHookMid uiScalingHook{};
-            uiScalingHook = safetyhook::create_mid(reinterpret_cast<void*>(hookAbsAddr),
-                [](SafetyHookContext& ctx) {
-                    *(float*)uiScalerAddr = 2.0f;
-                }
-            );
-            LOG("Hooked @ 0x{:x} + 0x{:x} = 0x{:x}", relAddr, hookOffset, hookRelAddr);
+        frameTimeHooked = true;
+        Render::onPresent([](Render::present_t& present) {
+            if (!hot.read().frametime) {
+                return;
+            }
+            FrameStats::frame();
+            static bool wasDown = false;
+            bool down = GetAsyncKeyState(VK_F10) & 0x8000;
+            if (down && !wasDown) {
+                LOG("{}", FrameStats::summary());
+                LOG("Written to ValkyriaChroniclesFix.frametimes.csv: {}", FrameStats::writeCsv("ValkyriaChroniclesFix.frametimes.csv"));
+            }
+            wasDown = down;
+        });
+    }
+#ifdef PROFILE_HOOKS
+    Render::onPresent([](Render::present_t& present) {
+        Profiler::frame();
+    });
+#endif
+}
+
+/**
+ * @brief Limits the frame rate and evens out frame pacing.
+ *
+ * This function performs the following tasks:
+ * 1. Checks if the frame limiter is enabled based on the configuration.
+ * 2. Configures the limiter for the fps from the configuration.
+ * 3. Waits for the next frame either right before `Present` or right after it, depending on the mode.
+ * 4. Follows changes to the fps and the mode published by `reloadYml()`, on the render thread.
+ *
+ * @details
+ * The game paces its frames with PS3-era timing that stutters on high refresh rate panels. In pacing
+ * mode the wait sits right before `Present`, so frames reach the screen at even intervals. In latency
+ * mode it sits right after `Present` returned, the game only starts its next frame, and with it
+ * sampling input and simulating, once the wait is over, so the input shown is as fresh as possible.
+ *
+ * @return void
+ */
+void frameLimiterFix() {
+    const hot_t& settings = hot.read();
+    LOG("Fix {}", settings.frameLimiter ? "Enabled" : "Disabled");
+    if (settings.frameLimiter) {
+        frameLimiterHooked = true;
+        Limiter::configure((double)settings.fps);
+        Render::onPresent([](Render::present_t& present) {
+            const hot_t& settings = hot.read();
+            static int fps = settings.fps;
+            if (settings.fps != fps) {
+                fps = settings.fps;
+                Limiter::configure((double)fps);
+            }
+            if (settings.frameLimiter && !settings.latency) {
+                Limiter::wait();
+            }
+        });
+        Render::afterPresent([](IDirect3DDevice9* device) {
+            const hot_t& settings = hot.read();
+            if (settings.frameLimiter && settings.latency) {
+                Limiter::wait();
+            }
+        });
+        LOG("Limiting to {} fps in {} mode with a {} timer", settings.fps, settings.latency ? "latency" : "pacing",
+            Limiter::highResolution() ? "high resolution" : "regular");
+    }
+}
+
+/**
+ * @brief Renders the game below the chosen resolution and stretches it back up.
+ *
+ * This function performs the following tasks:
+ * 1. Checks if render scaling is enabled based on the configuration.
+ * 2. Scales every viewport and scissor rect set while the backbuffer is bound, and the x and y
+ *    of pre-transformed vertices drawn into it, which no viewport moves.
+ * 3. On `Present` stretches the rendered part over the whole backbuffer and, in dynamic
+ *    mode, moves the scale towards whatever holds the target frame rate.
+ * 4. Follows changes published by `reloadYml()` between two frames.
+ *
+ * @details
+ * Ultrawide resolutions cost the GPU far more pixels than the 720p the game was made for.
+ * Only what is drawn straight into the backbuffer gets cheaper. The HUD is drawn into the
+ * same buffer with the same viewports, so it cannot stay at native resolution, and passes
+ * the game renders into its own offscreen targets keep their size. Pre-transformed vertices
+ * are scaled from a copy, one in a write only vertex buffer cannot be read and is drawn as is.
+ *
+ * @return void
+ */
+void renderScaleFix() {
+    const hot_t& settings = hot.read();
+    LOG("Fix {}", settings.renderScale ? "Enabled" : "Disabled");
+    if (settings.renderScale) {
+        renderScaleHooked = true;
+        Scaler::configure(settings.scale, settings.dynamicScale, (double)settings.targetFps);
+        Render::onPresent([](Render::present_t& present) {
+            // A limiter switched off by `reloadYml()` no longer waits, its last wait is not this frame's
+            const hot_t& settings = hot.read();
+            Scaler::present(present, settings.frameLimiter ? Limiter::waitedMs() : 0.0);
+            // Applied once this frame is out, the next one renders at the new scale from its first viewport
+            static hot_t applied = settings;
+            if (settings.renderScale != applied.renderScale || settings.scale != applied.scale
+                    || settings.dynamicScale != applied.dynamicScale || settings.targetFps != applied.targetFps) {
+                applied = settings;
+                Scaler::configure(settings.renderScale ? settings.scale : Scaler::maxScale,
+                    settings.renderScale && settings.dynamicScale, (double)settings.targetFps);
+            }
+        });
+        Render::onReset(Scaler::reset);
+        Render::afterSetRenderTarget(Scaler::renderTarget);
+        Render::onSetViewport(Scaler::viewport);
+        Render::onSetScissorRect(Scaler::scissorRect);
+        Render::onDraw(Scaler::draw);
+        Render::onDrawUp(Scaler::drawUp);
+        LOG("Rendering at {:.2f} of {}x{}, {}", Scaler::scale(), yml.resolution.width, yml.resolution.height,
+            settings.dynamicScale ? "dynamic" : "fixed");
+    }
+}
+
+/**
+ * @brief Lines of the overlay below the frame rate, see `overlayFix()`.
+ *
+ * @details
+ * Runs on the render thread every `Overlay::refreshMs`. The results of the registry are read
+ * from the `fixStates` snapshot, `reloadYml()` changes the originals on its own thread. In builds with
+ * `PROFILE_HOOKS` every hook shows its calls per frame and cycles per call since the previous
+ * refresh, a hook is counted under the entry whose name starts with the name of its site.
+ *
+ * @param lines Lines of the overlay.
+ * @param frames Frames presented since the previous call.
+ * @return void
+ */
+void overlayLines(std::vector<std::string>& lines, uint64_t frames) {
+    const hot_t& settings = hot.read();
+    if (renderScaleHooked && settings.renderScale) {
+        lines.push_back(std::format("render scale {:.2f} {}", Scaler::scale(), settings.dynamicScale ? "dynamic" : "fixed"));
+    }
+    else {
+        lines.push_back("render scale off");
+    }
+    if (frameLimiterHooked && settings.frameLimiter) {
+        lines.push_back(std::format("limit {} fps {}", settings.fps, settings.latency ? "latency" : "pacing"));
+    }
+
+#ifdef PROFILE_HOOKS
+    typedef struct snapshot_t {
+        uint64_t calls;
+        uint64_t cycles;
+    } snapshot_t;
+    static snapshot_t last[Profiler::maxSites];
+    std::span<const Profiler::site_t> sites = Profiler::registeredSites();
+#endif
+    const fixStates_t& states = fixStates.read();
+    for (size_t fix = 0; fix < states.count; fix++) {
+        const Registry::result_t& result = states.results[fix];
+        std::string line = std::format("{:<18} {:<9}", result.entry->name, Registry::stateName(result.state));
+#ifdef PROFILE_HOOKS
+        for (size_t i = 0; i < sites.size(); i++) {
+            if (!std::string_view(result.entry->name).starts_with(sites[i].name)) {
+                continue;
+            }
+            snapshot_t current{ sites[i].calls.load(std::memory_order_relaxed), sites[i].cycles.load(std::memory_order_relaxed) };
+            uint64_t calls = current.calls - last[i].calls;
+            uint64_t cycles = current.cycles - last[i].cycles;
+            last[i] = current;
+            line += std::format(" {:6.1f} calls/frame {:6} cycles/call", frames ? (double)calls / (double)frames : 0.0,
+                calls ? cycles / calls : 0);
+        }
+#endif
+        lines.push_back(line);
+    }
+}
+
+/**
+ * @brief Draws frame rate, frame times, render scale and the state of every fix over the game.
+ *
+ * This function performs the following tasks:
+ * 1. Checks if the overlay is enabled based on the configuration.
+ * 2. Times every `Present` and draws the overlay into the backbuffer right before it goes out,
+ *    after render scaling stretched it, so the overlay always stays sharp.
+ * 3. Shows or hides it on F11.
+ *
+ * @details
+ * The text is a 5x7 bitmap font drawn with plain d3d9 primitives, nothing is loaded from disk. The
+ * graph shows the last `Overlay::graphFrames` frame times from 0 to `Overlay::graphMaxMs`, frames
+ * over twice the average in red, so a stutter can be matched to a hook while playing.
+ *
+ * @return void
+ */
+void overlayFix() {
+    bool enable = hot.read().overlay;
+    LOG("Fix {}", enable ? "Enabled" : "Disabled");
+    if (enable) {
+        overlayHooked = true;
+        Overlay::configure(overlayLines);
+        Render::onPresent([](Render::present_t& present) {
+            static bool visible = true;
+            static bool wasDown = false;
+            bool down = GetAsyncKeyState(VK_F11) & 0x8000;
+            if (down && !wasDown) {
+                visible = !visible;
+            }
+            wasDown = down;
+            Overlay::present(present, visible && hot.read().overlay);
+        });
+        Render::onReset(Overlay::reset);
+    }
+}
+
+/**
+ * @brief Applies every hooking fix while the rest of the game is frozen.
+ *
+ * This function performs the following tasks:
+ * 1. Suspends every other thread, making sure none of them is stopped inside code that is about
+ *    to be hooked. A thread that does not move on from there gets a moment and another try, if
+ *    the game still can not be frozen 2. and 3. are left out, nothing is patched live.
+ * 2. Installs the `Frozen` phase of the fix registry.
+ * 3. Hooks the device functions any fix needs, read from the game's device if it was created by
+ *    now, otherwise looked up through a throwaway device before freezing.
+ * 4. Resumes the game, nothing can have run any of the hooks half written.
+ * 5. Logs how every fix went, nothing logs while the game is frozen.
+ *
+ * @return void
+ */
+void installHooks() {
+    std::vector<Utils::codeRange_t> ranges = Registry::ranges(fixes, signatureHits, Registry::phase_t::Frozen);
+
+    // The throwaway device is created before anything is frozen, d3d9 takes locks of its own
+    // Limiter first, the scaler then knows how long it waited and the recorder timestamps
+    // frames as they leave both, the overlay draws last over the finished frame
+    frameLimiterFix();
+    renderScaleFix();
+    frameTimeFix();
+    overlayFix();
+    Render::deviceFunctions_t deviceFunctions{};
+    bool render = false;
+    if (Render::hasCallbacks() && gameDevice) {
+        Render::findDeviceFunctions(gameDevice, &deviceFunctions);
+        render = true;
+        LOG("Device functions read from the game's device");
+    }
+    else if (Render::hasCallbacks()) {
+        Timeline::Scope scope("findDeviceFunctions");
+        render = Render::findDeviceFunctions(&deviceFunctions);
+        LOG("Device functions {}", render ? "found" : "not found, nothing that needs the device will work");
+    }
+    if (render) {
+        for (void* function : { deviceFunctions.reset, deviceFunctions.present, deviceFunctions.setRenderTarget,
+                deviceFunctions.endScene, deviceFunctions.setViewport, deviceFunctions.setScissorRect,
+                deviceFunctions.drawPrimitive, deviceFunctions.drawIndexedPrimitive, deviceFunctions.drawPrimitiveUP,
+                deviceFunctions.drawIndexedPrimitiveUP }) {
+            ranges.push_back({ (uintptr_t)function, hookPatchSize });
+        }
+    }
+
+    bool frozen = false;
+    int attempts = 0;
+    {
+        Timeline::Scope scope("installHooks");
+        while (!frozen && attempts++ < freezeAttempts) {
+            if (attempts > 1) {
+                Sleep(freezeRetryMs);
+            }
+            frozen = Utils::suspendAllThreads(ranges);
+        }
+        if (frozen) {
+            frozenFixes = installFixes(Registry::phase_t::Frozen);
+            if (render) {
+                render = Render::hook(deviceFunctions);
+            }
+            Utils::resumeAllThreads();
         }
         else {
-            LOG("Did not find '{}'", patternFind);
+            render = false;
         }
     }
+    // Only now, a suspended logger thread could have held the lock of its queue
+    logFixes(frozenFixes);
+    publishFixStates();
+    if (frozen) {
+        LOG("Hooks installed with the game frozen after {} attempt(s)", attempts);
+    }
+    else {
+        spdlog::warn("{} : Could not freeze the game in {} attempts, no hook is installed", __func__, freezeAttempts);
+    }
+    if (Render::hasCallbacks()) {
+        LOG("Device functions {}", render ? "hooked" : "could not be hooked");
+    }
 }
 
 /**
  * @brief This function serves as the entry point for the DLL. It performs the following tasks:
- * 1. Initializes the logging system.
- * 2. Reads the configuration from a YAML file.
- * 3. Applies a center UI icons fix.
- * 4. Applies a UI scaling fix.
- * 5. Applies a minimap overlay fix.
- * 6. Applies a textbox fix.
+ * 1. Waits for `init()` to run from the entry hook on the game's main thread, or runs it itself
+ *    and warns if the hook could not be installed or does not fire in time.
+ * 2. Drops to normal priority and waits for the game to create its device, for at most
+ *    `deviceTimeout` ms.
+ * 3. Applies every hooking fix in one freeze window.
+ * 4. Logs how long each of the above took and when `Main` started relative to process creation.
  *
  * @param lpParameter Unused parameter.
  * @return Always returns TRUE to indicate successful execution.
  */
 DWORD __stdcall Main(void* lpParameter) {
-    logInit();
-    readYml();
-    centerUiIconsFix();
-    uiScalingFix();
-    minimapOverlayFix();
-    textboxFix();
+    Timeline::mark("Main");
+    if (entryHookSlot) {
+        WaitForSingleObject(initEvent, entryHookTimeout);
+    }
+    if (!init("Main", false)) {
+        return false;
+    }
+    if (!initEarly) {
+        spdlog::warn("{} : The entry hook {}, the resolution fix was applied from `Main` and may land after the game's init code",
+            __func__, entryHookSlot ? std::format("did not fire within {} ms", entryHookTimeout) : "could not be installed");
+    }
+    // Only the resolution fix had to beat the game, nothing left here may compete with its startup
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_NORMAL);
+    if (watchingDevice) {
+        bool created = WaitForSingleObject(deviceEvent, deviceTimeout) == WAIT_OBJECT_0;
+        if (created) {
+            LOG("The game created its device, installing hooks");
+        }
+        else {
+            spdlog::warn("{} : The game did not create a device within {} ms, installing hooks anyway", __func__, deviceTimeout);
+        }
+    }
+    installHooks();
+    LOG("Timeline: {}", Timeline::summary());
+    if (yml.timeline.csv) {
+        Timeline::writeCsv("ValkyriaChroniclesFix.timeline.csv");
+    }
+    bool watching = Watcher::start(ymlPath.parent_path().string().c_str(), ymlPath.filename().string().c_str(), reloadYml);
+    LOG("{} {} for changes", watching ? "Watching" : "Could not watch", ymlPath.string());
+#ifdef PROFILE_HOOKS
+    // Nothing else left to do on this thread, it becomes the profiler's
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+    while (true) {
+        Sleep(PROFILE_INTERVAL * 1000);
+        LOG("Profile: {}", Profiler::summary());
+    }
+#endif
     return true;
 }
 
@@ -504,7 +1304,8 @@ DWORD __stdcall Main(void* lpParameter) {
  * different reasons for the call specified by `ul_reason_for_call`. In this implementation:
  *
  * - **DLL_PROCESS_ATTACH**: When the DLL is loaded into the address space of a process, it
- *   creates a new thread to run the `Main` function. The thread priority is set to the highest,
+ *   redirects the imports the entry hook and the device watch need and creates a new thread to
+ *   run the `Main` function. The thread priority is set to the highest until `init()` is done,
  *   and the thread handle is closed after creation.
  *
  * - **DLL_THREAD_ATTACH**: Called when a new thread is created in the process. No action is taken
@@ -513,7 +1314,9 @@ DWORD __stdcall Main(void* lpParameter) {
  * - **DLL_THREAD_DETACH**: Called when a thread exits cleanly. No action is taken in this implementation.
  *
  * - **DLL_PROCESS_DETACH**: Called when the DLL is unloaded from the address space of a process.
- *   No action is taken in this implementation.
+ *   In builds with `RECORD_EVENTS` writes the hot path events recorded by the hooks to
+ *   ValkyriaChroniclesFix.events.csv, and in builds with `TRACE_HOOKS` every recorded hook call
+ *   to ValkyriaChroniclesFix.trace.
  *
  * @param hModule Handle to the DLL module. This parameter is used to identify the DLL.
  * @param ul_reason_for_call Indicates the reason for the call (e.g., process attach, thread attach).
@@ -529,6 +1332,11 @@ BOOL APIENTRY DllMain(
     HANDLE currentThread;
     switch (ul_reason_for_call) {
     case DLL_PROCESS_ATTACH:
+        baseModule = GetModuleHandle(NULL);
+        initEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+        deviceEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+        installEntryHook();
+        watchingDevice = Render::watchDeviceCreation(baseModule, deviceCreated);
         mainHandle = CreateThread(NULL, 0, Main, 0, NULL, 0);
         if (mainHandle)
         {
@@ -537,7 +1345,14 @@ BOOL APIENTRY DllMain(
         }
     case DLL_THREAD_ATTACH:
     case DLL_THREAD_DETACH:
+        break;
     case DLL_PROCESS_DETACH:
+#ifdef RECORD_EVENTS
+        Events::dump("ValkyriaChroniclesFix.events.csv");
+#endif
+#ifdef TRACE_HOOKS
+        Trace::dump("ValkyriaChroniclesFix.trace");
+#endif
         break;
     }
     return TRUE;
@@ -0,0 +1,63 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Windows.h>
+#include <algorithm>
+#include <cstdio>
+
+#include "events.hpp"
+
+namespace Events
+{
+    event_t ring[ringSize];
+    std::atomic<uint32_t> head = 0;
+
+    bool dump(const char* path) {
+        uint32_t end = head.load(std::memory_order_acquire);
+        if (end == 0) {
+            return false;
+        }
+        HANDLE file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        char line[256];
+        DWORD written;
+        int length = snprintf(line, sizeof(line), "cycles,thread,event,arg\n");
+        WriteFile(file, line, (DWORD)length, &written, NULL);
+
+        uint32_t count = std::min(end, ringSize);
+        uint64_t first = ring[(end - count) & (ringSize - 1)].tsc;
+        for (uint32_t i = end - count; i != end; i++) {
+            const event_t& event = ring[i & (ringSize - 1)];
+            length = snprintf(line, sizeof(line), "%llu,%u,%s,0x%x\n",
+                (unsigned long long)(event.tsc - first), event.thread, event.name ? event.name : "?", event.arg);
+            if (length > 0) {
+                WriteFile(file, line, (DWORD)std::min(length, (int)sizeof(line) - 1), &written, NULL);
+            }
+        }
+        CloseHandle(file);
+        return true;
+    }
+}
@@ -0,0 +1,49 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <bit>
+
+#include "fixes.hpp"
+
+namespace Fixes
+{
+    std::vector<Hook::store_t> centerUiIcons() {
+        return { { ZYDIS_REGISTER_ESP, 0xC, std::bit_cast<uint32_t>(1280.0f) } };
+    }
+
+    std::vector<Hook::store_t> minimapOverlay(const constants_t& constants) {
+        return {
+            { ZYDIS_REGISTER_EAX, 0x90, std::bit_cast<uint32_t>(constants.minimapLeft) },
+            { ZYDIS_REGISTER_EAX, 0x98, std::bit_cast<uint32_t>(constants.minimapRight) },
+        };
+    }
+
+    std::vector<Hook::store_t> textbox() {
+        return { { ZYDIS_REGISTER_EBP, -0x8, std::bit_cast<uint32_t>(1280.0f) } };
+    }
+
+    std::vector<Hook::store_t> uiScaling(uintptr_t uiScaler) {
+        return { { ZYDIS_REGISTER_NONE, (int32_t)uiScaler, std::bit_cast<uint32_t>(2.0f) } };
+    }
+}
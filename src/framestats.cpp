@@ -0,0 +1,120 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Windows.h>
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <vector>
+
+#include "framestats.hpp"
+
+namespace
+{
+    // Only written from the render thread
+    LONGLONG timestamps[FrameStats::ringSize];
+    size_t head = 0;
+
+    double frequencyMs() {
+        static const double frequency = [] {
+            LARGE_INTEGER frequency;
+            QueryPerformanceFrequency(&frequency);
+            return (double)frequency.QuadPart / 1000.0;
+        }();
+        return frequency;
+    }
+
+    std::vector<double> frameTimes() {
+        size_t count = std::min(head, FrameStats::ringSize);
+        std::vector<double> times;
+        if (count < 2) {
+            return times;
+        }
+        times.reserve(count - 1);
+        for (size_t i = head - count + 1; i < head; i++) {
+            LONGLONG delta = timestamps[i % FrameStats::ringSize] - timestamps[(i - 1) % FrameStats::ringSize];
+            times.push_back((double)delta / frequencyMs());
+        }
+        return times;
+    }
+}
+
+namespace FrameStats
+{
+    void frame() {
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        timestamps[head % ringSize] = counter.QuadPart;
+        head++;
+    }
+
+    stats_t compute() {
+        stats_t stats{};
+        std::vector<double> times = frameTimes();
+        if (times.empty()) {
+            return stats;
+        }
+        double sum = 0.0;
+        for (double time : times) {
+            sum += time;
+        }
+        stats.frames = times.size();
+        stats.averageMs = sum / (double)times.size();
+        double squares = 0.0;
+        for (double time : times) {
+            squares += (time - stats.averageMs) * (time - stats.averageMs);
+        }
+        stats.varianceMs = squares / (double)times.size();
+        stats.averageFps = 1000.0 / stats.averageMs;
+
+        auto percentile = [&times](double fraction) {
+            size_t index = std::min(times.size() - 1, (size_t)std::ceil(fraction * (double)times.size()) - 1);
+            std::nth_element(times.begin(), times.begin() + index, times.end());
+            return times[index];
+        };
+        stats.low1Fps = 1000.0 / percentile(0.99);
+        stats.low01Fps = 1000.0 / percentile(0.999);
+        return stats;
+    }
+
+    std::string summary() {
+        stats_t stats = compute();
+        return std::format("{} frames avg {:.2f} ms ({:.1f} fps) var {:.2f} ms^2 1% low {:.1f} fps 0.1% low {:.1f} fps",
+            stats.frames, stats.averageMs, stats.averageFps, stats.varianceMs, stats.low1Fps, stats.low01Fps);
+    }
+
+    bool writeCsv(const char* path) {
+        std::vector<double> times = frameTimes();
+        std::ofstream file(path, std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+        file << "frame,frametime_ms\n";
+        for (size_t i = 0; i < times.size(); i++) {
+            file << std::format("{},{:.3f}\n", i, times[i]);
+        }
+        return (bool)file;
+    }
+}
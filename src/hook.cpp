@@ -0,0 +1,241 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Windows.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+#include "hook.hpp"
+#include "utils.hpp"
+
+namespace
+{
+    // Everything a dispatcher reads on every call, one cache line per site
+    typedef struct alignas(64) site_t {
+        std::atomic<uint32_t> enabled;      // Bit i runs handlers[i]
+        safetyhook::MidHookFn handlers[Hook::maxHandlers];
+    } site_t;
+
+    // Only touched while creating, kept away from the lines the dispatchers read
+    typedef struct siteHook_t {
+        void* target;
+        size_t handlers;                    // Slots handed out
+        SafetyHookMid hook;
+    } siteHook_t;
+
+    site_t sites[Hook::maxSites];
+    siteHook_t siteHooks[Hook::maxSites];
+    size_t siteCount = 0;
+    std::mutex sitesMutex;
+
+    // A mid hook calls a plain function, so every site gets its own that knows its index
+    template <size_t Index>
+    void dispatch(SafetyHookContext& ctx) {
+        const site_t& site = sites[Index];
+        for (uint32_t mask = site.enabled.load(std::memory_order_acquire); mask; mask &= mask - 1) {
+            site.handlers[std::countr_zero(mask)](ctx);
+        }
+    }
+
+    template <size_t... Index>
+    constexpr std::array<safetyhook::MidHookFn, sizeof...(Index)> makeDispatchers(std::index_sequence<Index...>) {
+        return { dispatch<Index>... };
+    }
+
+    constexpr std::array<safetyhook::MidHookFn, Hook::maxSites> dispatchers = makeDispatchers(std::make_index_sequence<Hook::maxSites>{});
+
+    // Stubs are never freed, an inline hook that is reset could still have a thread inside its stub
+    constexpr size_t arenaSize = 0x1000;
+    uint8_t* arena = nullptr;
+    size_t arenaUsed = 0;
+    std::mutex arenaMutex;
+
+    uint8_t* allocateStub(size_t size) {
+        std::lock_guard lock(arenaMutex);
+        if (!arena || arenaUsed + size > arenaSize) {
+            arena = (uint8_t*)VirtualAlloc(nullptr, arenaSize, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READ);
+            arenaUsed = 0;
+            if (!arena) {
+                return nullptr;
+            }
+        }
+        uint8_t* stub = arena + arenaUsed;
+        arenaUsed += (size + 15) & ~(size_t)15;
+        return stub;
+    }
+
+    bool encodeStore(const Hook::store_t& store, std::vector<uint8_t>* code) {
+        ZydisEncoderRequest request;
+        memset(&request, 0, sizeof(request));
+        request.mnemonic = ZYDIS_MNEMONIC_MOV;
+        request.machine_mode = ZYDIS_MACHINE_MODE_LEGACY_32;
+        request.operand_count = 2;
+        request.operands[0].type = ZYDIS_OPERAND_TYPE_MEMORY;
+        request.operands[0].mem.base = store.base;
+        request.operands[0].mem.displacement = store.displacement;
+        request.operands[0].mem.size = sizeof(uint32_t);
+        request.operands[1].type = ZYDIS_OPERAND_TYPE_IMMEDIATE;
+        request.operands[1].imm.u = store.value;
+
+        ZyanU8 buffer[ZYDIS_MAX_INSTRUCTION_LENGTH];
+        ZyanUSize length = sizeof(buffer);
+        if (!ZYAN_SUCCESS(ZydisEncoderEncodeInstruction(&request, buffer, &length))) {
+            return false;
+        }
+        code->insert(code->end(), buffer, buffer + length);
+        return true;
+    }
+
+    bool encodeJump(uintptr_t from, uintptr_t to, std::vector<uint8_t>* code) {
+        ZydisEncoderRequest request;
+        memset(&request, 0, sizeof(request));
+        request.mnemonic = ZYDIS_MNEMONIC_JMP;
+        request.machine_mode = ZYDIS_MACHINE_MODE_LEGACY_32;
+        request.branch_type = ZYDIS_BRANCH_TYPE_NEAR;
+        request.branch_width = ZYDIS_BRANCH_WIDTH_32;
+        request.operand_count = 1;
+        request.operands[0].type = ZYDIS_OPERAND_TYPE_IMMEDIATE;
+        request.operands[0].imm.u = to;
+
+        ZyanU8 buffer[ZYDIS_MAX_INSTRUCTION_LENGTH];
+        ZyanUSize length = sizeof(buffer);
+        if (!ZYAN_SUCCESS(ZydisEncoderEncodeInstructionAbsolute(&request, buffer, &length, from))) {
+            return false;
+        }
+        code->insert(code->end(), buffer, buffer + length);
+        return true;
+    }
+}
+
+namespace Hook
+{
+    bool Mid::create(void* target, safetyhook::MidHookFn handler) {
+        reset();
+        std::lock_guard lock(sitesMutex);
+        size_t index = std::find_if(siteHooks, siteHooks + siteCount,
+            [target](const siteHook_t& siteHook) { return siteHook.target == target; }) - siteHooks;
+        if (index == maxSites) {
+            return false;
+        }
+        siteHook_t& siteHook = siteHooks[index];
+        bool reuse = index < siteCount && this->target == target;
+        if (!reuse && index < siteCount && siteHook.handlers == maxHandlers) {
+            return false;
+        }
+        size_t slot = reuse ? this->slot : (index < siteCount ? siteHook.handlers : 0);
+
+        // Published by the bit, a dispatcher never sees the slot before the handler is in it
+        sites[index].handlers[slot] = handler;
+        sites[index].enabled.fetch_or(1u << slot, std::memory_order_release);
+        if (index == siteCount) {
+            siteHook.hook = safetyhook::create_mid(target, dispatchers[index]);
+            if (!siteHook.hook) {
+                sites[index].enabled.store(0, std::memory_order_relaxed);
+                return false;
+            }
+            siteHook.target = target;
+            siteHook.handlers = 0;
+            siteCount++;
+        }
+        if (!reuse) {
+            siteHook.handlers++;
+        }
+        this->site = index;
+        this->slot = slot;
+        this->target = target;
+        return true;
+    }
+
+    void Mid::reset() {
+        if (site != maxSites) {
+            sites[site].enabled.fetch_and(~(1u << slot), std::memory_order_relaxed);
+            site = maxSites;
+        }
+    }
+
+    bool Mid::setEnabled(bool enable) {
+        if (site == maxSites) {
+            return false;
+        }
+        if (enable) {
+            sites[site].enabled.fetch_or(1u << slot, std::memory_order_release);
+        }
+        else {
+            sites[site].enabled.fetch_and(~(1u << slot), std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    bool Store::create(void* target, const std::vector<store_t>& stores, safetyhook::MidHookFn fallback) {
+        reset();
+
+        std::vector<uint8_t> code;
+        bool encoded = true;
+        for (const store_t& store : stores) {
+            encoded = encoded && encodeStore(store, &code);
+        }
+#if defined(PROFILE_HOOKS) || defined(TRACE_HOOKS)
+        // The stub has no body to measure or record, the fallback is where both hook in
+        encoded = false;
+#endif
+        // The jump is encoded relative to where it ends up, so the stub is placed first
+        constexpr size_t jumpSize = 5;
+        stub = encoded ? allocateStub(code.size() + jumpSize) : nullptr;
+        if (stub) {
+            // Disabled until the stub jumps to the trampoline, which only exists once the hook does
+            inlineHook = safetyhook::create_inline(target, stub, SafetyHookInline::StartDisabled);
+            if (inlineHook && encodeJump((uintptr_t)stub + code.size(), inlineHook.original<uintptr_t>(), &code)) {
+                Utils::patch((uintptr_t)stub, code.data(), code.size());
+                FlushInstructionCache(GetCurrentProcess(), stub, code.size());
+                if (inlineHook.enable()) {
+                    return true;
+                }
+            }
+            inlineHook = {};
+        }
+
+        return midHook.create(target, fallback);
+    }
+
+    void Store::reset() {
+        inlineHook = {};
+        midHook.reset();
+        stub = nullptr;
+    }
+
+    bool Store::setEnabled(bool enable) {
+        if (inlineHook) {
+            return (bool)(enable ? inlineHook.enable() : inlineHook.disable());
+        }
+        if (midHook) {
+            return midHook.setEnabled(enable);
+        }
+        return false;
+    }
+}
@@ -0,0 +1,121 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Windows.h>
+#include <timeapi.h>
+
+#include "limiter.hpp"
+
+// Older SDKs do not have it, Windows before 10 1803 rejects it and the regular timer is used
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+namespace
+{
+    // Part of each wait spent spinning, per timer kind, in ms
+    constexpr double highResolutionSpinMs = 0.5;
+    constexpr double regularSpinMs = 2.0;
+
+    // System timer period in ms the regular timer needs, its wake ups are a default 15.6 ms period late otherwise
+    constexpr UINT regularPeriodMs = 1;
+
+    HANDLE timer = NULL;
+    bool isHighResolution = false;
+    LONGLONG frequency = 0;     // QPC ticks per second
+    LONGLONG period = 0;        // QPC ticks per frame
+    LONGLONG spin = 0;          // QPC ticks
+    LONGLONG deadline = 0;      // QPC ticks, 0 until the first frame
+    LONGLONG waited = 0;        // QPC ticks spent in the last wait
+    bool periodRaised = false;  // `regularPeriodMs` is requested from the system
+
+    LONGLONG now() {
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        return counter.QuadPart;
+    }
+}
+
+namespace Limiter
+{
+    void configure(double fps) {
+        if (!timer) {
+            timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+            isHighResolution = timer != NULL;
+            if (!timer) {
+                timer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+            }
+            LARGE_INTEGER counter;
+            QueryPerformanceFrequency(&counter);
+            frequency = counter.QuadPart;
+        }
+        period = fps > 0.0 ? (LONGLONG)((double)frequency / fps) : 0;
+        // Only held while limiting, a finer system timer costs power in every process
+        bool raise = !isHighResolution && timer && period != 0;
+        if (raise != periodRaised) {
+            periodRaised = raise && timeBeginPeriod(regularPeriodMs) == TIMERR_NOERROR;
+            if (!raise) {
+                timeEndPeriod(regularPeriodMs);
+            }
+        }
+        spin = (LONGLONG)((isHighResolution ? highResolutionSpinMs : regularSpinMs) * (double)frequency / 1000.0);
+        deadline = 0;
+        waited = 0;
+    }
+
+    void wait() {
+        waited = 0;
+        if (period == 0) {
+            return;
+        }
+        LONGLONG current = now();
+        if (deadline == 0 || current - deadline > period) {
+            deadline = current + period;
+            return;
+        }
+
+        LONGLONG remaining = deadline - current;
+        if (timer && remaining > spin) {
+            // Relative due time in 100ns units
+            LARGE_INTEGER due;
+            due.QuadPart = -(LONGLONG)((double)(remaining - spin) * 10'000'000.0 / (double)frequency);
+            if (SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE)) {
+                WaitForSingleObject(timer, INFINITE);
+            }
+        }
+        while (now() < deadline) {
+            YieldProcessor();
+        }
+        waited = now() - current;
+        deadline += period;
+    }
+
+    double waitedMs() {
+        return frequency ? (double)waited * 1000.0 / (double)frequency : 0.0;
+    }
+
+    bool highResolution() {
+        return isHighResolution;
+    }
+}
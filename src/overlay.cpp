@@ -0,0 +1,348 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Windows.h>
+#include <d3d9.h>
+#include <algorithm>
+#include <format>
+
+#include "overlay.hpp"
+
+namespace
+{
+    constexpr DWORD vertexFormat = D3DFVF_XYZRHW | D3DFVF_DIFFUSE | D3DFVF_TEX1;
+
+    // The atlas holds one 8x8 texel cell per glyph from ' ' to 0x7F, a glyph is 5x7 and
+    // leaves the rest of its cell as spacing
+    constexpr int cellSize = 8;
+    constexpr int glyphAdvance = 6;
+    constexpr int atlasColumns = 16;
+    constexpr UINT atlasWidth = 128;
+    constexpr UINT atlasHeight = 64;
+    constexpr unsigned char firstGlyph = ' ';
+    constexpr unsigned char solidGlyph = 0x7F;      // Fully set, its top left texel is sampled for solid quads
+
+    // One byte per column, bit 0 is the top row
+    constexpr uint8_t font[96][5] = {
+        { 0x00, 0x00, 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0x5F, 0x00, 0x00 }, { 0x00, 0x07, 0x00, 0x07, 0x00 }, { 0x14, 0x7F, 0x14, 0x7F, 0x14 },
+        { 0x24, 0x2A, 0x7F, 0x2A, 0x12 }, { 0x23, 0x13, 0x08, 0x64, 0x62 }, { 0x36, 0x49, 0x55, 0x22, 0x50 }, { 0x00, 0x05, 0x03, 0x00, 0x00 },
+        { 0x00, 0x1C, 0x22, 0x41, 0x00 }, { 0x00, 0x41, 0x22, 0x1C, 0x00 }, { 0x08, 0x2A, 0x1C, 0x2A, 0x08 }, { 0x08, 0x08, 0x3E, 0x08, 0x08 },
+        { 0x00, 0x50, 0x30, 0x00, 0x00 }, { 0x08, 0x08, 0x08, 0x08, 0x08 }, { 0x00, 0x60, 0x60, 0x00, 0x00 }, { 0x20, 0x10, 0x08, 0x04, 0x02 },
+        { 0x3E, 0x51, 0x49, 0x45, 0x3E }, { 0x00, 0x42, 0x7F, 0x40, 0x00 }, { 0x42, 0x61, 0x51, 0x49, 0x46 }, { 0x21, 0x41, 0x45, 0x4B, 0x31 },
+        { 0x18, 0x14, 0x12, 0x7F, 0x10 }, { 0x27, 0x45, 0x45, 0x45, 0x39 }, { 0x3C, 0x4A, 0x49, 0x49, 0x30 }, { 0x01, 0x71, 0x09, 0x05, 0x03 },
+        { 0x36, 0x49, 0x49, 0x49, 0x36 }, { 0x06, 0x49, 0x49, 0x29, 0x1E }, { 0x00, 0x36, 0x36, 0x00, 0x00 }, { 0x00, 0x56, 0x36, 0x00, 0x00 },
+        { 0x08, 0x14, 0x22, 0x41, 0x00 }, { 0x14, 0x14, 0x14, 0x14, 0x14 }, { 0x00, 0x41, 0x22, 0x14, 0x08 }, { 0x02, 0x01, 0x51, 0x09, 0x06 },
+        { 0x32, 0x49, 0x79, 0x41, 0x3E }, { 0x7E, 0x11, 0x11, 0x11, 0x7E }, { 0x7F, 0x49, 0x49, 0x49, 0x36 }, { 0x3E, 0x41, 0x41, 0x41, 0x22 },
+        { 0x7F, 0x41, 0x41, 0x22, 0x1C }, { 0x7F, 0x49, 0x49, 0x49, 0x41 }, { 0x7F, 0x09, 0x09, 0x01, 0x01 }, { 0x3E, 0x41, 0x41, 0x51, 0x32 },
+        { 0x7F, 0x08, 0x08, 0x08, 0x7F }, { 0x00, 0x41, 0x7F, 0x41, 0x00 }, { 0x20, 0x40, 0x41, 0x3F, 0x01 }, { 0x7F, 0x08, 0x14, 0x22, 0x41 },
+        { 0x7F, 0x40, 0x40, 0x40, 0x40 }, { 0x7F, 0x02, 0x04, 0x02, 0x7F }, { 0x7F, 0x04, 0x08, 0x10, 0x7F }, { 0x3E, 0x41, 0x41, 0x41, 0x3E },
+        { 0x7F, 0x09, 0x09, 0x09, 0x06 }, { 0x3E, 0x41, 0x51, 0x21, 0x5E }, { 0x7F, 0x09, 0x19, 0x29, 0x46 }, { 0x46, 0x49, 0x49, 0x49, 0x31 },
+        { 0x01, 0x01, 0x7F, 0x01, 0x01 }, { 0x3F, 0x40, 0x40, 0x40, 0x3F }, { 0x1F, 0x20, 0x40, 0x20, 0x1F }, { 0x7F, 0x20, 0x18, 0x20, 0x7F },
+        { 0x63, 0x14, 0x08, 0x14, 0x63 }, { 0x03, 0x04, 0x78, 0x04, 0x03 }, { 0x61, 0x51, 0x49, 0x45, 0x43 }, { 0x00, 0x7F, 0x41, 0x41, 0x00 },
+        { 0x02, 0x04, 0x08, 0x10, 0x20 }, { 0x00, 0x41, 0x41, 0x7F, 0x00 }, { 0x04, 0x02, 0x01, 0x02, 0x04 }, { 0x40, 0x40, 0x40, 0x40, 0x40 },
+        { 0x00, 0x01, 0x02, 0x04, 0x00 }, { 0x20, 0x54, 0x54, 0x54, 0x78 }, { 0x7F, 0x48, 0x44, 0x44, 0x38 }, { 0x38, 0x44, 0x44, 0x44, 0x20 },
+        { 0x38, 0x44, 0x44, 0x48, 0x7F }, { 0x38, 0x54, 0x54, 0x54, 0x18 }, { 0x08, 0x7E, 0x09, 0x01, 0x02 }, { 0x08, 0x14, 0x54, 0x54, 0x3C },
+        { 0x7F, 0x08, 0x04, 0x04, 0x78 }, { 0x00, 0x44, 0x7D, 0x40, 0x00 }, { 0x20, 0x40, 0x44, 0x3D, 0x00 }, { 0x00, 0x7F, 0x10, 0x28, 0x44 },
+        { 0x00, 0x41, 0x7F, 0x40, 0x00 }, { 0x7C, 0x04, 0x18, 0x04, 0x78 }, { 0x7C, 0x08, 0x04, 0x04, 0x78 }, { 0x38, 0x44, 0x44, 0x44, 0x38 },
+        { 0x7C, 0x14, 0x14, 0x14, 0x08 }, { 0x08, 0x14, 0x14, 0x18, 0x7C }, { 0x7C, 0x08, 0x04, 0x04, 0x08 }, { 0x48, 0x54, 0x54, 0x54, 0x20 },
+        { 0x04, 0x3F, 0x44, 0x40, 0x20 }, { 0x3C, 0x40, 0x40, 0x20, 0x7C }, { 0x1C, 0x20, 0x40, 0x20, 0x1C }, { 0x3C, 0x40, 0x30, 0x40, 0x3C },
+        { 0x44, 0x28, 0x10, 0x28, 0x44 }, { 0x0C, 0x50, 0x50, 0x50, 0x3C }, { 0x44, 0x64, 0x54, 0x4C, 0x44 }, { 0x00, 0x08, 0x36, 0x41, 0x00 },
+        { 0x00, 0x00, 0x7F, 0x00, 0x00 }, { 0x00, 0x41, 0x36, 0x08, 0x00 }, { 0x02, 0x01, 0x02, 0x04, 0x02 }, { 0x7F, 0x7F, 0x7F, 0x7F, 0x7F },
+    };
+
+    constexpr D3DCOLOR backgroundColor = D3DCOLOR_ARGB(0xB0, 0x00, 0x00, 0x00);
+    constexpr D3DCOLOR textColor = D3DCOLOR_ARGB(0xFF, 0xFF, 0xFF, 0xFF);
+    constexpr D3DCOLOR graphColor = D3DCOLOR_ARGB(0xFF, 0x40, 0xE0, 0x40);
+    constexpr D3DCOLOR spikeColor = D3DCOLOR_ARGB(0xFF, 0xFF, 0x40, 0x40);  // Frames over twice the average
+
+    typedef struct vertex_t {
+        float x, y, z, rhw;
+        D3DCOLOR color;
+        float u, v;
+    } vertex_t;
+
+    Overlay::linesCallback_t linesCallback = nullptr;
+    LONGLONG frequency = 0;     // QPC ticks per second
+    LONGLONG lastPresent = 0;   // QPC ticks, 0 until the first frame
+
+    // Ring of the last frame times for the graph
+    float frameTimes[Overlay::graphFrames];
+    size_t frameHead = 0;
+
+    // Frames since the text was last updated
+    double windowMs = 0.0;
+    double windowMaxMs = 0.0;
+    uint64_t windowFrames = 0;
+    double averageMs = 0.0;     // Of the previous window
+    std::vector<std::string> lines;
+
+    IDirect3DTexture9* atlas = nullptr;     // Managed, survives a reset
+    IDirect3DStateBlock9* saved = nullptr;  // Recorded from `setStates`, released on reset
+    bool failed = false;                    // The atlas could not be created, nothing is drawn
+    std::vector<vertex_t> vertices;         // Kept between frames to keep its allocation
+
+    LONGLONG now() {
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        return counter.QuadPart;
+    }
+
+    bool createAtlas(IDirect3DDevice9* device) {
+        if (FAILED(device->CreateTexture(atlasWidth, atlasHeight, 1, 0, D3DFMT_A8R8G8B8, D3DPOOL_MANAGED, &atlas, NULL))) {
+            atlas = nullptr;
+            return false;
+        }
+        D3DLOCKED_RECT locked;
+        if (FAILED(atlas->LockRect(0, &locked, NULL, 0))) {
+            atlas->Release();
+            atlas = nullptr;
+            return false;
+        }
+        for (UINT y = 0; y < atlasHeight; y++) {
+            auto row = (DWORD*)((uint8_t*)locked.pBits + y * locked.Pitch);
+            for (UINT x = 0; x < atlasWidth; x++) {
+                size_t glyph = (y / cellSize) * atlasColumns + x / cellSize;
+                UINT column = x % cellSize;
+                UINT line = y % cellSize;
+                bool set = glyph < std::size(font) && column < 5 && line < 7 && (font[glyph][column] >> line) & 1;
+                // White everywhere so a texel only ever carries coverage, the vertex color tints it
+                row[x] = set ? 0xFFFFFFFF : 0x00FFFFFF;
+            }
+        }
+        atlas->UnlockRect(0);
+        return true;
+    }
+
+    void quad(float x0, float y0, float x1, float y1, D3DCOLOR color, float u0, float v0, float u1, float v1) {
+        // Pixel centers sit at .0 in d3d9, shifting by half a pixel maps texels 1:1
+        x0 -= 0.5f; y0 -= 0.5f; x1 -= 0.5f; y1 -= 0.5f;
+        vertex_t a{ x0, y0, 0.0f, 1.0f, color, u0, v0 };
+        vertex_t b{ x1, y0, 0.0f, 1.0f, color, u1, v0 };
+        vertex_t c{ x0, y1, 0.0f, 1.0f, color, u0, v1 };
+        vertex_t d{ x1, y1, 0.0f, 1.0f, color, u1, v1 };
+        vertices.insert(vertices.end(), { a, b, c, c, b, d });
+    }
+
+    void solid(float x0, float y0, float x1, float y1, D3DCOLOR color) {
+        int cell = solidGlyph - firstGlyph;
+        float u = ((float)(cell % atlasColumns * cellSize) + 0.5f) / (float)atlasWidth;
+        float v = ((float)(cell / atlasColumns * cellSize) + 0.5f) / (float)atlasHeight;
+        quad(x0, y0, x1, y1, color, u, v, u, v);
+    }
+
+    void text(float x, float y, float pixel, const std::string& line, D3DCOLOR color) {
+        for (char c : line) {
+            auto glyph = (unsigned char)c;
+            if (glyph > firstGlyph && glyph < solidGlyph) {
+                int cell = glyph - firstGlyph;
+                float u = (float)(cell % atlasColumns * cellSize) / (float)atlasWidth;
+                float v = (float)(cell / atlasColumns * cellSize) / (float)atlasHeight;
+                quad(x, y, x + glyphAdvance * pixel, y + cellSize * pixel, color,
+                    u, v, u + (float)glyphAdvance / (float)atlasWidth, v + (float)cellSize / (float)atlasHeight);
+            }
+            x += glyphAdvance * pixel;
+        }
+    }
+
+    void setStates(IDirect3DDevice9* device) {
+        device->SetVertexShader(NULL);
+        device->SetPixelShader(NULL);
+        device->SetFVF(vertexFormat);
+        device->SetTexture(0, atlas);
+        device->SetRenderState(D3DRS_ZENABLE, D3DZB_FALSE);
+        device->SetRenderState(D3DRS_ZWRITEENABLE, FALSE);
+        device->SetRenderState(D3DRS_STENCILENABLE, FALSE);
+        device->SetRenderState(D3DRS_ALPHATESTENABLE, FALSE);
+        device->SetRenderState(D3DRS_ALPHABLENDENABLE, TRUE);
+        device->SetRenderState(D3DRS_BLENDOP, D3DBLENDOP_ADD);
+        device->SetRenderState(D3DRS_SRCBLEND, D3DBLEND_SRCALPHA);
+        device->SetRenderState(D3DRS_DESTBLEND, D3DBLEND_INVSRCALPHA);
+        device->SetRenderState(D3DRS_SEPARATEALPHABLENDENABLE, FALSE);
+        device->SetRenderState(D3DRS_CULLMODE, D3DCULL_NONE);
+        device->SetRenderState(D3DRS_FILLMODE, D3DFILL_SOLID);
+        device->SetRenderState(D3DRS_LIGHTING, FALSE);
+        device->SetRenderState(D3DRS_FOGENABLE, FALSE);
+        device->SetRenderState(D3DRS_SCISSORTESTENABLE, FALSE);
+        device->SetRenderState(D3DRS_CLIPPLANEENABLE, 0);
+        device->SetRenderState(D3DRS_SRGBWRITEENABLE, FALSE);
+        device->SetRenderState(D3DRS_COLORWRITEENABLE, 0x0F);
+        device->SetTextureStageState(0, D3DTSS_COLOROP, D3DTOP_MODULATE);
+        device->SetTextureStageState(0, D3DTSS_COLORARG1, D3DTA_TEXTURE);
+        device->SetTextureStageState(0, D3DTSS_COLORARG2, D3DTA_DIFFUSE);
+        device->SetTextureStageState(0, D3DTSS_ALPHAOP, D3DTOP_MODULATE);
+        device->SetTextureStageState(0, D3DTSS_ALPHAARG1, D3DTA_TEXTURE);
+        device->SetTextureStageState(0, D3DTSS_ALPHAARG2, D3DTA_DIFFUSE);
+        device->SetTextureStageState(0, D3DTSS_TEXCOORDINDEX, 0);
+        device->SetTextureStageState(0, D3DTSS_TEXTURETRANSFORMFLAGS, D3DTTFF_DISABLE);
+        device->SetTextureStageState(1, D3DTSS_COLOROP, D3DTOP_DISABLE);
+        device->SetTextureStageState(1, D3DTSS_ALPHAOP, D3DTOP_DISABLE);
+        device->SetSamplerState(0, D3DSAMP_MINFILTER, D3DTEXF_POINT);
+        device->SetSamplerState(0, D3DSAMP_MAGFILTER, D3DTEXF_POINT);
+        device->SetSamplerState(0, D3DSAMP_MIPFILTER, D3DTEXF_NONE);
+        device->SetSamplerState(0, D3DSAMP_ADDRESSU, D3DTADDRESS_CLAMP);
+        device->SetSamplerState(0, D3DSAMP_ADDRESSV, D3DTADDRESS_CLAMP);
+        device->SetSamplerState(0, D3DSAMP_SRGBTEXTURE, FALSE);
+    }
+
+    // A block of just the states `draw` changes, capturing all of them costs far more every frame
+    bool recordStates(IDirect3DDevice9* device) {
+        if (FAILED(device->BeginStateBlock())) {
+            return false;
+        }
+        // Only which states are recorded matters, `Capture` fills in the game's values
+        D3DVIEWPORT9 viewport{ 0, 0, 1, 1, 0.0f, 1.0f };
+        device->SetViewport(&viewport);
+        // `DrawPrimitiveUP` unbinds stream 0
+        device->SetStreamSource(0, NULL, 0, 0);
+        setStates(device);
+        if (FAILED(device->EndStateBlock(&saved))) {
+            saved = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    void build(UINT height) {
+        // Twice the size from 1080p up, the 5x7 font is unreadable on large screens otherwise
+        float pixel = (float)std::max<UINT>(1, height / 540);
+        float margin = 8.0f * pixel;
+        float padding = 4.0f * pixel;
+        float lineHeight = (float)(cellSize + 1) * pixel;
+        float graphHeight = 48.0f * pixel;
+
+        size_t longest = 0;
+        for (const std::string& line : lines) {
+            longest = std::max(longest, line.size());
+        }
+        float width = std::max((float)(longest * glyphAdvance) * pixel, (float)Overlay::graphFrames * pixel);
+        float textHeight = (float)lines.size() * lineHeight;
+
+        vertices.clear();
+        solid(margin, margin, margin + width + 2.0f * padding, margin + textHeight + graphHeight + 3.0f * padding, backgroundColor);
+        float x = margin + padding;
+        float y = margin + padding;
+        for (const std::string& line : lines) {
+            text(x, y, pixel, line, textColor);
+            y += lineHeight;
+        }
+
+        // Oldest frame on the left, the newest one enters on the right
+        float bottom = y + padding + graphHeight;
+        size_t count = std::min(frameHead, Overlay::graphFrames);
+        for (size_t i = 0; i < count; i++) {
+            float ms = frameTimes[(frameHead - count + i) % Overlay::graphFrames];
+            float bar = std::min(1.0f, ms / (float)Overlay::graphMaxMs) * graphHeight;
+            float left = x + (float)(Overlay::graphFrames - count + i) * pixel;
+            solid(left, bottom - std::max(bar, pixel), left + pixel, bottom,
+                averageMs > 0.0 && ms > 2.0 * averageMs ? spikeColor : graphColor);
+        }
+    }
+
+    void draw(IDirect3DDevice9* device) {
+        if (failed) {
+            return;
+        }
+        if (!atlas && !createAtlas(device)) {
+            failed = true;
+            return;
+        }
+        Render::Direct direct;
+        if (!saved && !recordStates(device)) {
+            return;
+        }
+        IDirect3DSurface9* backBuffer = nullptr;
+        if (FAILED(device->GetBackBuffer(0, 0, D3DBACKBUFFER_TYPE_MONO, &backBuffer))) {
+            return;
+        }
+        D3DSURFACE_DESC desc;
+        backBuffer->GetDesc(&desc);
+        build(desc.Height);
+
+        IDirect3DSurface9* target = nullptr;
+        device->GetRenderTarget(0, &target);
+        saved->Capture();
+        device->SetRenderTarget(0, backBuffer);
+        D3DVIEWPORT9 full{ 0, 0, desc.Width, desc.Height, 0.0f, 1.0f };
+        device->SetViewport(&full);
+        setStates(device);
+        if (SUCCEEDED(device->BeginScene())) {
+            device->DrawPrimitiveUP(D3DPT_TRIANGLELIST, (UINT)(vertices.size() / 3), vertices.data(), sizeof(vertex_t));
+            device->EndScene();
+        }
+        // Binding a target resets the viewport, the state block puts the game's back
+        if (target) {
+            device->SetRenderTarget(0, target);
+            target->Release();
+        }
+        saved->Apply();
+        backBuffer->Release();
+    }
+}
+
+namespace Overlay
+{
+    void configure(linesCallback_t callback) {
+        linesCallback = callback;
+        LARGE_INTEGER counter;
+        QueryPerformanceFrequency(&counter);
+        frequency = counter.QuadPart;
+        lastPresent = 0;
+    }
+
+    void present(Render::present_t& present, bool visible) {
+        LONGLONG time = now();
+        if (lastPresent) {
+            double ms = (double)(time - lastPresent) * 1000.0 / (double)frequency;
+            frameTimes[frameHead % graphFrames] = (float)ms;
+            frameHead++;
+            windowMs += ms;
+            windowMaxMs = std::max(windowMaxMs, ms);
+            windowFrames++;
+        }
+        lastPresent = time;
+
+        if (windowMs >= refreshMs) {
+            averageMs = windowMs / (double)windowFrames;
+            lines.clear();
+            lines.push_back(std::format("{:.1f} fps {:.2f} ms avg {:.2f} ms max", 1000.0 / averageMs, averageMs, windowMaxMs));
+            if (linesCallback) {
+                linesCallback(lines, windowFrames);
+            }
+            windowMs = 0.0;
+            windowMaxMs = 0.0;
+            windowFrames = 0;
+        }
+        if (visible && !lines.empty()) {
+            draw(present.device);
+        }
+    }
+
+    void reset(IDirect3DDevice9* device) {
+        if (saved) {
+            saved->Release();
+            saved = nullptr;
+        }
+        lastPresent = 0;
+    }
+}
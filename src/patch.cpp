@@ -0,0 +1,298 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file patch.cpp
+ * @brief Offline patcher, writes the resolution fix into Valkyria.exe on disk
+ *
+ * Native replacement of ValkyriaChroniclesPatch.py from older releases. The DLL
+ * applies the same patch in memory at every launch, this is for installs where
+ * the exe itself has to carry the resolution, e.g. when patching many installs
+ * from a script. The exe is memory mapped and only the bytes of the resolution
+ * math are written, searched for with the same scanner and signatures as the DLL.
+ *
+ * Usage:
+ *      ValkyriaChroniclesPatch.exe [--yml path] [--restore] <path to Valkyria.exe>
+ *
+ * The yml defaults to ValkyriaChroniclesFix.yml in the working directory. The first
+ * run that changes anything copies the exe to Valkyria.exe.bak, later runs leave
+ * the backup alone. The PE checksum is updated if the exe carries one. A run with
+ * the resolution already in the exe writes nothing at all. `--restore` copies the
+ * backup back over the exe. Exits with 0 on success, also when nothing changed.
+ */
+
+// System includes
+#include <windows.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// 3rd party includes
+#include "yaml-cpp/yaml.h"
+
+// Local includes
+#include "utils.hpp"
+#include "config.hpp"
+#include "signatures.hpp"
+
+typedef struct mapping_t {
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+    uint8_t* view = nullptr;
+    size_t size = 0;
+} mapping_t;
+
+/**
+ * @brief Maps a whole file into memory, laid out as on disk.
+ *
+ * @param path Path to the file
+ * @param writable Map for writing, the file is opened without sharing
+ * @param file Receives the mapping
+ * @return true on success
+ */
+bool mapFile(const char* path, bool writable, mapping_t* file) {
+    file->file = CreateFileA(path, writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+        writable ? 0 : FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file->file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file->file, &size) || size.QuadPart == 0) {
+        return false;
+    }
+    file->size = (size_t)size.QuadPart;
+    file->mapping = CreateFileMappingA(file->file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+    if (!file->mapping) {
+        return false;
+    }
+    file->view = (uint8_t*)MapViewOfFile(file->mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+    return file->view != nullptr;
+}
+
+void unmapFile(mapping_t* file) {
+    if (file->view) {
+        FlushViewOfFile(file->view, 0);
+        UnmapViewOfFile(file->view);
+    }
+    if (file->mapping) {
+        CloseHandle(file->mapping);
+    }
+    if (file->file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file->file);
+    }
+    *file = {};
+}
+
+/**
+ * @brief NT headers of a PE file mapped as on disk.
+ *
+ * @param file Mapped file
+ * @return nullptr if the file is not a PE file
+ */
+PIMAGE_NT_HEADERS ntHeaders(const mapping_t& file) {
+    auto dosHeader = (PIMAGE_DOS_HEADER)file.view;
+    if (file.size < sizeof(IMAGE_DOS_HEADER) || dosHeader->e_magic != IMAGE_DOS_SIGNATURE
+        || (size_t)dosHeader->e_lfanew + sizeof(IMAGE_NT_HEADERS) > file.size) {
+        return nullptr;
+    }
+    auto headers = (PIMAGE_NT_HEADERS)(file.view + dosHeader->e_lfanew);
+    return headers->Signature == IMAGE_NT_SIGNATURE ? headers : nullptr;
+}
+
+/**
+ * @brief Searches the raw data of every executable section, the headers are never touched.
+ *
+ * @param file Mapped file
+ * @param pattern Pattern to search for
+ * @return File offsets of every hit in ascending order
+ */
+std::vector<size_t> find(const mapping_t& file, const Utils::pattern_t& pattern) {
+    PIMAGE_NT_HEADERS headers = ntHeaders(file);
+    auto section = IMAGE_FIRST_SECTION(headers);
+    std::vector<uint64_t> hits;
+    for (WORD i = 0; i < headers->FileHeader.NumberOfSections; i++, section++) {
+        if (!(section->Characteristics & IMAGE_SCN_MEM_EXECUTE) || section->PointerToRawData >= file.size) {
+            continue;
+        }
+        size_t size = std::min<size_t>(section->SizeOfRawData, file.size - section->PointerToRawData);
+        Utils::patternScan(file.view + section->PointerToRawData, size, pattern, &hits);
+    }
+    std::vector<size_t> offsets;
+    for (uint64_t hit : hits) {
+        offsets.push_back((size_t)(hit - (uint64_t)file.view));
+    }
+    return offsets;
+}
+
+/**
+ * @brief The checksum of the optional header, as computed by `CheckSumMappedFile`.
+ * @details Sum of every 16-bit word of the file with the carry folded back in,
+ *      skipping the checksum field itself, plus the length of the file.
+ *
+ * @param file Mapped file
+ * @return uint32_t
+ */
+uint32_t peChecksum(const mapping_t& file) {
+    size_t field = (size_t)((uint8_t*)&ntHeaders(file)->OptionalHeader.CheckSum - file.view);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < file.size; i += 2) {
+        if (i == field || i == field + 2) {
+            continue;
+        }
+        uint32_t word = file.view[i] | (i + 1 < file.size ? file.view[i + 1] << 8 : 0);
+        sum += word;
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return (uint32_t)sum + (uint32_t)file.size;
+}
+
+/**
+ * @brief Finds the resolution math, or the patch already written over it.
+ * @details Same rule as `resolveSignatures`, except that a candidate only counts if it
+ *      has exactly the hits it expects. A change on disk is permanent, so nothing is
+ *      guessed.
+ *
+ * @param file Mapped file
+ * @param offset Receives the file offset of the hit
+ * @return The candidate found, nullptr if no candidate resolved uniquely
+ */
+const candidate_t* findResolution(const mapping_t& file, size_t* offset) {
+    for (const candidate_t& candidate : signatureDatabase[ResolutionSignature]) {
+        std::vector<size_t> hits = find(file, candidate.signature.pattern);
+        if (hits.size() == candidate.expectedHits) {
+            *offset = hits[0] + candidate.fixup;
+            return &candidate;
+        }
+        printf("'%s' (%s): %zu hit(s)\n", candidate.signature.pattern.text, candidate.note, hits.size());
+    }
+    return nullptr;
+}
+
+int restore(const std::string& exe, const std::string& backup) {
+    if (!CopyFileA(backup.c_str(), exe.c_str(), FALSE)) {
+        printf("Could not restore %s from %s (error %lu)\n", exe.c_str(), backup.c_str(), GetLastError());
+        return 1;
+    }
+    printf("Restored %s from %s\n", exe.c_str(), backup.c_str());
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    const char* path = nullptr;
+    std::string ymlPath = "ValkyriaChroniclesFix.yml";
+    bool restoring = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--yml" && i + 1 < argc) {
+            ymlPath = argv[++i];
+        } else if (arg == "--restore") {
+            restoring = true;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (!path) {
+        printf("Usage: ValkyriaChroniclesPatch.exe [--yml path] [--restore] <path to Valkyria.exe>\n");
+        return 1;
+    }
+    std::string exe = path;
+    std::string backup = exe + ".bak";
+    if (restoring) {
+        return restore(exe, backup);
+    }
+
+    yml_t yml;
+    try {
+        // No cache, it would only be one more file next to the user's yml that nothing reads
+        Config::load(ymlPath.c_str(), nullptr, &yml);
+    } catch (const YAML::Exception& e) {
+        printf("%s could not be read: %s\n", ymlPath.c_str(), e.what());
+        return 1;
+    }
+    if (!yml.masterEnable) {
+        printf("masterEnable is false, nothing to patch\n");
+        return 0;
+    }
+    std::pair<int, int> desktop = Utils::GetDesktopDimensions();
+    if (yml.resolution.width == 0 || yml.resolution.height == 0) {
+        yml.resolution.width = desktop.first;
+        yml.resolution.height = desktop.second;
+    }
+    std::vector<uint8_t> code = resolutionPatch((uint32_t)yml.resolution.width, (uint32_t)yml.resolution.height,
+        (uint32_t)((desktop.first - yml.resolution.width) / 2));
+
+    // Look first without write access, a run that changes nothing must not touch the file
+    mapping_t file;
+    size_t offset = 0;
+    if (!mapFile(exe.c_str(), false, &file) || !ntHeaders(file)) {
+        printf("Could not read %s as an exe (error %lu)\n", exe.c_str(), GetLastError());
+        unmapFile(&file);
+        return 1;
+    }
+    const candidate_t* candidate = findResolution(file, &offset);
+    bool current = candidate && offset + code.size() <= file.size && memcmp(file.view + offset, code.data(), code.size()) == 0;
+    unmapFile(&file);
+    if (!candidate) {
+        printf("The resolution code was not found, this build of Valkyria.exe is not supported\n");
+        return 1;
+    }
+    printf("Found '%s' (%s) @ 0x%zx\n", candidate->signature.pattern.text, candidate->note, offset);
+    if (current) {
+        printf("Already patched for %dx%d, nothing to do\n", yml.resolution.width, yml.resolution.height);
+        return 0;
+    }
+
+    // Only the first change keeps a backup, later ones would back up an already patched exe
+    if (CopyFileA(exe.c_str(), backup.c_str(), TRUE)) {
+        printf("Backed up to %s\n", backup.c_str());
+    } else if (GetLastError() != ERROR_FILE_EXISTS) {
+        printf("Could not back up to %s (error %lu), nothing was changed\n", backup.c_str(), GetLastError());
+        return 1;
+    }
+
+    if (!mapFile(exe.c_str(), true, &file) || !ntHeaders(file)) {
+        printf("Could not open %s for writing (error %lu), is the game running?\n", exe.c_str(), GetLastError());
+        unmapFile(&file);
+        return 1;
+    }
+    memcpy(file.view + offset, code.data(), code.size());
+    DWORD& field = ntHeaders(file)->OptionalHeader.CheckSum;
+    DWORD previous = field;
+    if (field) {
+        field = peChecksum(file);
+    }
+    DWORD checksum = field;
+    unmapFile(&file);
+    printf("Patched '%s' @ 0x%zx for %dx%d\n", Utils::bytesToString(code.data(), code.size()).c_str(), offset,
+        yml.resolution.width, yml.resolution.height);
+    if (previous) {
+        printf("Checksum 0x%08lx -> 0x%08lx\n", (unsigned long)previous, (unsigned long)checksum);
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifdef PROFILE_HOOKS
+
+#include <Windows.h>
+#include <format>
+#include <mutex>
+
+#include "profiler.hpp"
+
+namespace
+{
+    typedef struct snapshot_t {
+        uint64_t calls;
+        uint64_t cycles;
+    } snapshot_t;
+
+    Profiler::site_t sites[Profiler::maxSites];
+    Profiler::site_t overflow;
+    size_t siteCount = 0;
+    std::mutex sitesMutex;
+    std::atomic<uint64_t> frames = 0;
+
+    // Only touched by `summary`
+    snapshot_t lastSites[Profiler::maxSites];
+    uint64_t lastFrames = 0;
+    ULONGLONG lastTime = GetTickCount64();
+}
+
+namespace Profiler
+{
+    site_t& site(const char* name) {
+        std::lock_guard lock(sitesMutex);
+        if (siteCount == maxSites) {
+            return overflow;
+        }
+        sites[siteCount].name = name;
+        return sites[siteCount++];
+    }
+
+    std::span<const site_t> registeredSites() {
+        std::lock_guard lock(sitesMutex);
+        return { sites, siteCount };
+    }
+
+    void frame() {
+        frames.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::string summary() {
+        size_t count;
+        {
+            std::lock_guard lock(sitesMutex);
+            count = siteCount;
+        }
+        uint64_t frameCount = frames.load(std::memory_order_relaxed);
+        uint64_t newFrames = frameCount - lastFrames;
+        ULONGLONG time = GetTickCount64();
+        double seconds = (double)(time - lastTime) / 1000.0;
+        lastFrames = frameCount;
+        lastTime = time;
+
+        std::string line = newFrames ? std::format("{} frames", newFrames) : std::format("{:.1f} s", seconds);
+        for (size_t i = 0; i < count; i++) {
+            snapshot_t current{ sites[i].calls.load(std::memory_order_relaxed), sites[i].cycles.load(std::memory_order_relaxed) };
+            uint64_t calls = current.calls - lastSites[i].calls;
+            uint64_t cycles = current.cycles - lastSites[i].cycles;
+            lastSites[i] = current;
+
+            double rate = newFrames ? (double)calls / (double)newFrames : (seconds > 0.0 ? (double)calls / seconds : 0.0);
+            line += std::format(" | {} {:.1f} calls/{} {} cycles", sites[i].name, rate, newFrames ? "frame" : "s",
+                calls ? cycles / calls : 0);
+        }
+        return line;
+    }
+}
+
+#endif
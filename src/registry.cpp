@@ -0,0 +1,131 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include "timeline.hpp"
+#include "registry.hpp"
+
+namespace
+{
+    uintptr_t address(const Registry::entry_t& entry, const std::vector<std::vector<uint64_t>>& hits) {
+        if ((size_t)entry.signature >= hits.size() || hits[entry.signature].empty()) {
+            return 0;
+        }
+        return (uintptr_t)hits[entry.signature][0] + entry.offset;
+    }
+}
+
+namespace Registry
+{
+    std::vector<Utils::codeRange_t> ranges(const std::vector<entry_t>& entries,
+        const std::vector<std::vector<uint64_t>>& hits, phase_t phase) {
+        std::vector<Utils::codeRange_t> ranges;
+        for (const entry_t& entry : entries) {
+            uintptr_t at = address(entry, hits);
+            if (entry.phase == phase && at && entry.enabled()) {
+                ranges.push_back({ at, entry.patchSize });
+            }
+        }
+        return ranges;
+    }
+
+    bool writesCode(const std::vector<entry_t>& entries, signatureId_t signature) {
+        return std::any_of(entries.begin(), entries.end(), [signature](const entry_t& entry) {
+            return entry.signature == signature && entry.patchSize > 0;
+        });
+    }
+
+    std::vector<result_t> install(const std::vector<entry_t>& entries,
+        const std::vector<std::vector<uint64_t>>& hits, phase_t phase) {
+        std::vector<result_t> results;
+        for (const entry_t& entry : entries) {
+            if (entry.phase != phase) {
+                continue;
+            }
+            result_t result{ &entry, state_t::Disabled, 0, 0 };
+            if (entry.enabled()) {
+                result.address = address(entry, hits);
+                result.hits = (size_t)entry.signature < hits.size() ? hits[entry.signature].size() : 0;
+                if (!result.address) {
+                    result.state = state_t::NotFound;
+                }
+                else {
+                    Timeline::Scope scope(entry.name);
+                    result.state = entry.install(result.address) ? state_t::Installed : state_t::Failed;
+                }
+            }
+            results.push_back(result);
+        }
+        return results;
+    }
+
+    std::vector<result_t> update(const std::vector<std::vector<uint64_t>>& hits, std::vector<result_t>& results,
+        std::vector<const entry_t*>* restart) {
+        std::vector<result_t> changed;
+        for (result_t& result : results) {
+            const entry_t& entry = *result.entry;
+            bool want = entry.enabled();
+            state_t before = result.state;
+            if (want && result.state == state_t::Disabled) {
+                if (!address(entry, hits)) {
+                    result.hits = 0;
+                    result.state = state_t::NotFound;
+                }
+                else {
+                    restart->push_back(&entry);
+                }
+            }
+            else if (!want && result.state == state_t::NotFound) {
+                result.state = state_t::Disabled;
+            }
+            else if (entry.toggle && want != (result.state == state_t::Installed)
+                && (result.state == state_t::Installed || result.state == state_t::Off)) {
+                if (entry.toggle(want)) {
+                    result.state = want ? state_t::Installed : state_t::Off;
+                }
+            }
+            if (result.state != before) {
+                changed.push_back(result);
+            }
+        }
+        return changed;
+    }
+
+    const char* stateName(state_t state) {
+        switch (state) {
+        case state_t::Disabled:
+            return "disabled";
+        case state_t::NotFound:
+            return "not found";
+        case state_t::Installed:
+            return "installed";
+        case state_t::Off:
+            return "off";
+        case state_t::Failed:
+            return "failed";
+        }
+        return "unknown";
+    }
+}
@@ -0,0 +1,387 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Windows.h>
+#include <d3d9.h>
+#include <atomic>
+
+#include "safetyhook.hpp"
+
+#include "render.hpp"
+#include "utils.hpp"
+
+namespace
+{
+    // Indices into the IDirect3DDevice9 vtable
+    constexpr size_t resetIndex = 16;
+    constexpr size_t presentIndex = 17;
+    constexpr size_t setRenderTargetIndex = 37;
+    constexpr size_t endSceneIndex = 42;
+    constexpr size_t setViewportIndex = 47;
+    constexpr size_t setScissorRectIndex = 75;
+    constexpr size_t drawPrimitiveIndex = 81;
+    constexpr size_t drawIndexedPrimitiveIndex = 82;
+    constexpr size_t drawPrimitiveUPIndex = 83;
+    constexpr size_t drawIndexedPrimitiveUPIndex = 84;
+
+    // Index into the IDirect3D9 vtable
+    constexpr size_t createDeviceIndex = 16;
+
+    template <typename T>
+    struct callbacks_t {
+        T list[Render::maxCallbacks];
+        size_t count = 0;
+
+        void add(T callback) {
+            if (count < Render::maxCallbacks) {
+                list[count++] = callback;
+            }
+        }
+
+        template <typename... Args>
+        void run(Args&... args) const {
+            for (size_t i = 0; i < count; i++) {
+                list[i](args...);
+            }
+        }
+
+        // For callbacks that return true once they took over the call
+        template <typename... Args>
+        bool any(Args&... args) const {
+            for (size_t i = 0; i < count; i++) {
+                if (list[i](args...)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    callbacks_t<Render::presentCallback_t> presentCallbacks;
+    callbacks_t<Render::presentedCallback_t> presentedCallbacks;
+    callbacks_t<Render::endSceneCallback_t> endSceneCallbacks;
+    callbacks_t<Render::resetCallback_t> resetCallbacks;
+    callbacks_t<Render::renderTargetCallback_t> renderTargetCallbacks;
+    callbacks_t<Render::viewportCallback_t> viewportCallbacks;
+    callbacks_t<Render::scissorRectCallback_t> scissorRectCallbacks;
+    callbacks_t<Render::drawCallback_t> drawCallbacks;
+    callbacks_t<Render::drawUpCallback_t> drawUpCallbacks;
+
+    int direct = 0;             // Open `Render::Direct` scopes, callbacks are skipped while not 0
+
+    SafetyHookInline resetHook{};
+    SafetyHookInline presentHook{};
+    SafetyHookInline setRenderTargetHook{};
+    SafetyHookInline endSceneHook{};
+    SafetyHookInline setViewportHook{};
+    SafetyHookInline setScissorRectHook{};
+    SafetyHookInline drawPrimitiveHook{};
+    SafetyHookInline drawIndexedPrimitiveHook{};
+    SafetyHookInline drawPrimitiveUPHook{};
+    SafetyHookInline drawIndexedPrimitiveUPHook{};
+
+    HRESULT __stdcall reset(IDirect3DDevice9* device, D3DPRESENT_PARAMETERS* parameters) {
+        if (!direct) {
+            resetCallbacks.run(device);
+        }
+        return resetHook.stdcall<HRESULT>(device, parameters);
+    }
+
+    HRESULT __stdcall present(IDirect3DDevice9* device, const RECT* sourceRect, const RECT* destRect, HWND window, const RGNDATA* dirtyRegion) {
+        Render::present_t args{ device, sourceRect, destRect, window, dirtyRegion };
+        if (!direct) {
+            presentCallbacks.run(args);
+        }
+        HRESULT result = presentHook.stdcall<HRESULT>(args.device, args.sourceRect, args.destRect, args.window, args.dirtyRegion);
+        if (!direct) {
+            presentedCallbacks.run(device);
+        }
+        return result;
+    }
+
+    HRESULT __stdcall setRenderTarget(IDirect3DDevice9* device, DWORD index, IDirect3DSurface9* surface) {
+        HRESULT result = setRenderTargetHook.stdcall<HRESULT>(device, index, surface);
+        if (SUCCEEDED(result) && !direct) {
+            renderTargetCallbacks.run(device, index, surface);
+        }
+        return result;
+    }
+
+    HRESULT __stdcall endScene(IDirect3DDevice9* device) {
+        if (!direct) {
+            endSceneCallbacks.run(device);
+        }
+        return endSceneHook.stdcall<HRESULT>(device);
+    }
+
+    HRESULT __stdcall setViewport(IDirect3DDevice9* device, const D3DVIEWPORT9* viewport) {
+        if (!viewport || direct) {
+            return setViewportHook.stdcall<HRESULT>(device, viewport);
+        }
+        D3DVIEWPORT9 changed = *viewport;
+        viewportCallbacks.run(device, changed);
+        return setViewportHook.stdcall<HRESULT>(device, &changed);
+    }
+
+    HRESULT __stdcall setScissorRect(IDirect3DDevice9* device, const RECT* rect) {
+        if (!rect || direct) {
+            return setScissorRectHook.stdcall<HRESULT>(device, rect);
+        }
+        RECT changed = *rect;
+        scissorRectCallbacks.run(device, changed);
+        return setScissorRectHook.stdcall<HRESULT>(device, &changed);
+    }
+
+    HRESULT __stdcall drawPrimitive(IDirect3DDevice9* device, D3DPRIMITIVETYPE type, UINT start, UINT primitives) {
+        if (!direct) {
+            Render::draw_t draw{ device, type, false, 0, 0, 0, start, primitives };
+            if (drawCallbacks.any(draw)) {
+                return D3D_OK;
+            }
+        }
+        return drawPrimitiveHook.stdcall<HRESULT>(device, type, start, primitives);
+    }
+
+    HRESULT __stdcall drawIndexedPrimitive(IDirect3DDevice9* device, D3DPRIMITIVETYPE type, INT baseVertex, UINT minIndex,
+        UINT vertexCount, UINT start, UINT primitives) {
+        if (!direct) {
+            Render::draw_t draw{ device, type, true, baseVertex, minIndex, vertexCount, start, primitives };
+            if (drawCallbacks.any(draw)) {
+                return D3D_OK;
+            }
+        }
+        return drawIndexedPrimitiveHook.stdcall<HRESULT>(device, type, baseVertex, minIndex, vertexCount, start, primitives);
+    }
+
+    HRESULT __stdcall drawPrimitiveUP(IDirect3DDevice9* device, D3DPRIMITIVETYPE type, UINT primitives, const void* vertices, UINT stride) {
+        if (vertices && !direct) {
+            UINT vertexCount = Render::primitiveVertices(type, primitives);
+            drawUpCallbacks.run(device, vertexCount, vertices, stride);
+        }
+        return drawPrimitiveUPHook.stdcall<HRESULT>(device, type, primitives, vertices, stride);
+    }
+
+    HRESULT __stdcall drawIndexedPrimitiveUP(IDirect3DDevice9* device, D3DPRIMITIVETYPE type, UINT minIndex, UINT vertexCount,
+        UINT primitives, const void* indices, D3DFORMAT indexFormat, const void* vertices, UINT stride) {
+        if (vertices && !direct) {
+            // Indices count from the first vertex, not from `minIndex`
+            UINT readVertices = minIndex + vertexCount;
+            drawUpCallbacks.run(device, readVertices, vertices, stride);
+        }
+        return drawIndexedPrimitiveUPHook.stdcall<HRESULT>(device, type, minIndex, vertexCount, primitives, indices,
+            indexFormat, vertices, stride);
+    }
+
+    typedef HRESULT (__stdcall* createDevice_t)(IDirect3D9* d3d, UINT adapter, D3DDEVTYPE type, HWND window,
+        DWORD flags, D3DPRESENT_PARAMETERS* parameters, IDirect3DDevice9** device);
+
+    void** direct3DCreate9Slot = nullptr;
+    decltype(&Direct3DCreate9) direct3DCreate9 = nullptr;
+    void** createDeviceSlot = nullptr;
+    createDevice_t createDevice = nullptr;
+    Render::deviceCreatedCallback_t deviceCreated = nullptr;
+    std::atomic<bool> deviceSeen = false;
+
+    HRESULT __stdcall createDeviceHook(IDirect3D9* d3d, UINT adapter, D3DDEVTYPE type, HWND window,
+        DWORD flags, D3DPRESENT_PARAMETERS* parameters, IDirect3DDevice9** device) {
+        HRESULT result = createDevice(d3d, adapter, type, window, flags, parameters, device);
+        if (SUCCEEDED(result) && device && *device && !deviceSeen.exchange(true)) {
+            Utils::patch((uintptr_t)createDeviceSlot, (const uint8_t*)&createDevice, sizeof(void*));
+            Utils::patch((uintptr_t)direct3DCreate9Slot, (const uint8_t*)&direct3DCreate9, sizeof(void*));
+            deviceCreated(*device);
+        }
+        return result;
+    }
+
+    IDirect3D9* WINAPI direct3DCreate9Hook(UINT version) {
+        IDirect3D9* d3d = direct3DCreate9(version);
+        // Every IDirect3D9 shares one vtable, patching it once covers them all
+        if (d3d && !createDeviceSlot && !deviceSeen) {
+            createDeviceSlot = &(*(void***)d3d)[createDeviceIndex];
+            createDevice = (createDevice_t)*createDeviceSlot;
+            auto hook = &createDeviceHook;
+            Utils::patch((uintptr_t)createDeviceSlot, (const uint8_t*)&hook, sizeof(void*));
+        }
+        return d3d;
+    }
+
+    void readVtable(IDirect3DDevice9* device, Render::deviceFunctions_t* functions) {
+        void** vtable = *(void***)device;
+        functions->reset = vtable[resetIndex];
+        functions->present = vtable[presentIndex];
+        functions->setRenderTarget = vtable[setRenderTargetIndex];
+        functions->endScene = vtable[endSceneIndex];
+        functions->setViewport = vtable[setViewportIndex];
+        functions->setScissorRect = vtable[setScissorRectIndex];
+        functions->drawPrimitive = vtable[drawPrimitiveIndex];
+        functions->drawIndexedPrimitive = vtable[drawIndexedPrimitiveIndex];
+        functions->drawPrimitiveUP = vtable[drawPrimitiveUPIndex];
+        functions->drawIndexedPrimitiveUP = vtable[drawIndexedPrimitiveUPIndex];
+    }
+
+    bool hookIf(bool needed, SafetyHookInline& hook, void* target, void* destination) {
+        if (!needed) {
+            return true;
+        }
+        hook = safetyhook::create_inline(target, destination);
+        return (bool)hook;
+    }
+}
+
+namespace Render
+{
+    UINT primitiveVertices(D3DPRIMITIVETYPE type, UINT primitives) {
+        switch (type) {
+        case D3DPT_POINTLIST:
+            return primitives;
+        case D3DPT_LINELIST:
+            return primitives * 2;
+        case D3DPT_LINESTRIP:
+            return primitives + 1;
+        case D3DPT_TRIANGLELIST:
+            return primitives * 3;
+        case D3DPT_TRIANGLESTRIP:
+        case D3DPT_TRIANGLEFAN:
+            return primitives + 2;
+        default:
+            return 0;
+        }
+    }
+
+    bool findDeviceFunctions(deviceFunctions_t* functions) {
+        HMODULE d3d9 = LoadLibraryA("d3d9.dll");
+        if (!d3d9) {
+            return false;
+        }
+        auto direct3DCreate = (decltype(&Direct3DCreate9))GetProcAddress(d3d9, "Direct3DCreate9");
+        IDirect3D9* d3d = direct3DCreate ? direct3DCreate(D3D_SDK_VERSION) : nullptr;
+        if (!d3d) {
+            return false;
+        }
+
+        HWND window = CreateWindowExA(0, "STATIC", "", WS_POPUP, 0, 0, 1, 1, NULL, NULL, NULL, NULL);
+        D3DPRESENT_PARAMETERS parameters{};
+        parameters.Windowed = TRUE;
+        parameters.SwapEffect = D3DSWAPEFFECT_DISCARD;
+        parameters.hDeviceWindow = window;
+        parameters.BackBufferFormat = D3DFMT_UNKNOWN;
+        parameters.BackBufferWidth = 1;
+        parameters.BackBufferHeight = 1;
+
+        // Straight to d3d9 even while `watchDeviceCreation` waits, this device is not the game's
+        IDirect3DDevice9* device = nullptr;
+        createDevice_t createDeviceFn = createDevice ? createDevice : (createDevice_t)(*(void***)d3d)[createDeviceIndex];
+        HRESULT result = createDeviceFn(d3d, D3DADAPTER_DEFAULT, D3DDEVTYPE_HAL, window,
+            D3DCREATE_SOFTWARE_VERTEXPROCESSING | D3DCREATE_DISABLE_DRIVER_MANAGEMENT, &parameters, &device);
+        if (SUCCEEDED(result) && device) {
+            readVtable(device, functions);
+            device->Release();
+        }
+        d3d->Release();
+        if (window) {
+            DestroyWindow(window);
+        }
+        return SUCCEEDED(result);
+    }
+
+    void findDeviceFunctions(IDirect3DDevice9* device, deviceFunctions_t* functions) {
+        readVtable(device, functions);
+    }
+
+    bool watchDeviceCreation(HMODULE module, deviceCreatedCallback_t callback) {
+        direct3DCreate9Slot = Utils::findImport(module, "d3d9.dll", "Direct3DCreate9");
+        if (!direct3DCreate9Slot) {
+            return false;
+        }
+        deviceCreated = callback;
+        direct3DCreate9 = (decltype(&Direct3DCreate9))*direct3DCreate9Slot;
+        auto hook = &direct3DCreate9Hook;
+        Utils::patch((uintptr_t)direct3DCreate9Slot, (const uint8_t*)&hook, sizeof(void*));
+        return true;
+    }
+
+    bool hook(const deviceFunctions_t& functions) {
+        bool ok = hookIf(true, presentHook, functions.present, reinterpret_cast<void*>(&present));
+        ok &= hookIf(true, endSceneHook, functions.endScene, reinterpret_cast<void*>(&endScene));
+        ok &= hookIf(resetCallbacks.count, resetHook, functions.reset, reinterpret_cast<void*>(&reset));
+        ok &= hookIf(renderTargetCallbacks.count, setRenderTargetHook, functions.setRenderTarget, reinterpret_cast<void*>(&setRenderTarget));
+        ok &= hookIf(viewportCallbacks.count, setViewportHook, functions.setViewport, reinterpret_cast<void*>(&setViewport));
+        ok &= hookIf(scissorRectCallbacks.count, setScissorRectHook, functions.setScissorRect, reinterpret_cast<void*>(&setScissorRect));
+        ok &= hookIf(drawCallbacks.count, drawPrimitiveHook, functions.drawPrimitive, reinterpret_cast<void*>(&drawPrimitive));
+        ok &= hookIf(drawCallbacks.count, drawIndexedPrimitiveHook, functions.drawIndexedPrimitive, reinterpret_cast<void*>(&drawIndexedPrimitive));
+        ok &= hookIf(drawUpCallbacks.count, drawPrimitiveUPHook, functions.drawPrimitiveUP, reinterpret_cast<void*>(&drawPrimitiveUP));
+        ok &= hookIf(drawUpCallbacks.count, drawIndexedPrimitiveUPHook, functions.drawIndexedPrimitiveUP, reinterpret_cast<void*>(&drawIndexedPrimitiveUP));
+        return ok;
+    }
+
+    void onPresent(presentCallback_t callback) {
+        presentCallbacks.add(callback);
+    }
+
+    void afterPresent(presentedCallback_t callback) {
+        presentedCallbacks.add(callback);
+    }
+
+    void onEndScene(endSceneCallback_t callback) {
+        endSceneCallbacks.add(callback);
+    }
+
+    void onReset(resetCallback_t callback) {
+        resetCallbacks.add(callback);
+    }
+
+    void afterSetRenderTarget(renderTargetCallback_t callback) {
+        renderTargetCallbacks.add(callback);
+    }
+
+    void onSetViewport(viewportCallback_t callback) {
+        viewportCallbacks.add(callback);
+    }
+
+    void onSetScissorRect(scissorRectCallback_t callback) {
+        scissorRectCallbacks.add(callback);
+    }
+
+    void onDraw(drawCallback_t callback) {
+        drawCallbacks.add(callback);
+    }
+
+    void onDrawUp(drawUpCallback_t callback) {
+        drawUpCallbacks.add(callback);
+    }
+
+    Direct::Direct() {
+        direct++;
+    }
+
+    Direct::~Direct() {
+        direct--;
+    }
+
+    bool hasCallbacks() {
+        return presentCallbacks.count || presentedCallbacks.count || endSceneCallbacks.count || resetCallbacks.count
+            || renderTargetCallbacks.count || viewportCallbacks.count || scissorRectCallbacks.count
+            || drawCallbacks.count || drawUpCallbacks.count;
+    }
+}
@@ -0,0 +1,90 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Windows.h>
+#include <mutex>
+#include <unordered_map>
+
+#include "resolver.hpp"
+
+namespace
+{
+    std::mutex cacheMutex;
+    std::unordered_map<uintptr_t, Resolver::reference_t> cache;     // By RVA
+
+    Resolver::reference_t decode(uintptr_t address) {
+        Resolver::reference_t reference{};
+        ZydisDecoder decoder;
+        ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LEGACY_32, ZYDIS_STACK_WIDTH_32);
+        ZydisDecodedInstruction instruction;
+        ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+        if (!ZYAN_SUCCESS(ZydisDecoderDecodeFull(&decoder, (const void*)address, ZYDIS_MAX_INSTRUCTION_LENGTH, &instruction, operands))) {
+            return reference;
+        }
+        reference.mnemonic = instruction.mnemonic;
+        reference.length = instruction.length;
+
+        // Hidden operands such as the implicit stack of a push never point anywhere interesting
+        for (ZyanU8 i = 0; i < instruction.operand_count_visible; i++) {
+            const ZydisDecodedOperand& operand = operands[i];
+            ZyanU64 absolute = 0;
+            if (operand.type == ZYDIS_OPERAND_TYPE_MEMORY) {
+                // Fails for anything based on a register, which is only known at runtime
+                if (ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&instruction, &operand, address, &absolute))) {
+                    reference.memory = (uintptr_t)absolute;
+                }
+            }
+            else if (operand.type == ZYDIS_OPERAND_TYPE_IMMEDIATE && operand.imm.is_relative) {
+                if (ZYAN_SUCCESS(ZydisCalcAbsoluteAddress(&instruction, &operand, address, &absolute))) {
+                    reference.target = (uintptr_t)absolute;
+                }
+            }
+            else if (operand.type == ZYDIS_OPERAND_TYPE_IMMEDIATE) {
+                reference.immediate = operand.imm.value.u;
+                reference.hasImmediate = true;
+            }
+        }
+        return reference;
+    }
+}
+
+namespace Resolver
+{
+    reference_t resolve(HMODULE module, uintptr_t address) {
+        uintptr_t rva = address - (uintptr_t)module;
+        {
+            std::lock_guard lock(cacheMutex);
+            auto cached = cache.find(rva);
+            if (cached != cache.end()) {
+                return cached->second;
+            }
+        }
+        reference_t reference = decode(address);
+        if (reference.length) {
+            std::lock_guard lock(cacheMutex);
+            cache.emplace(rva, reference);
+        }
+        return reference;
+    }
+}
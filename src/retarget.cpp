@@ -0,0 +1,449 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Windows.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <map>
+#include <string>
+
+#include "retarget.hpp"
+
+namespace
+{
+    using Retarget::kind_t;
+    using Retarget::use_t;
+    using Retarget::reference_t;
+
+    // What each of `constantSignatures` finds
+    typedef struct constant_t {
+        int value;
+        kind_t kind;
+        bool immediate;         // Searched for in .text, otherwise a constant in .rdata
+    } constant_t;
+
+    constexpr constant_t constants[] = {
+        { 1280, kind_t::Int, true },
+        { 1920, kind_t::Int, true },
+        { 1280, kind_t::Float, true },
+        { 1920, kind_t::Float, true },
+        { 1280, kind_t::Float, false },
+        { 1920, kind_t::Float, false },
+        { 1280, kind_t::Double, false },
+        { 1920, kind_t::Double, false },
+    };
+
+    const std::vector<Utils::signature_t> constantSignatures = {
+        { Utils::Signature<"00 05 00 00">(), ".text" },
+        { Utils::Signature<"80 07 00 00">(), ".text" },
+        { Utils::Signature<"00 00 A0 44">(), ".text" },
+        { Utils::Signature<"00 00 F0 44">(), ".text" },
+        { Utils::Signature<"00 00 A0 44">(), ".rdata" },
+        { Utils::Signature<"00 00 F0 44">(), ".rdata" },
+        { Utils::Signature<"00 00 00 00 00 00 94 40">(), ".rdata" },
+        { Utils::Signature<"00 00 00 00 00 00 9E 40">(), ".rdata" },
+    };
+
+    constexpr const char* kindNames[] = { "int", "float", "double" };
+    constexpr const char* useNames[] = { "load", "store", "compare", "arithmetic", "push", "other" };
+
+    typedef struct named_t {
+        const char* name;
+        float constants_t::* field;
+    } named_t;
+
+    // Values a rule can retarget to by name, see `constants_t`
+    constexpr named_t namedConstants[] = {
+        { "width", &constants_t::width },
+        { "height", &constants_t::height },
+        { "defaultWidth", &constants_t::defaultWidth },
+        { "pixelScaler", &constants_t::pixelScaler },
+        { "centerOffset", &constants_t::centerOffset },
+        { "uiScale", &constants_t::uiScale },
+        { "viewportScale", &constants_t::viewportScale },
+        { "uiOffset", &constants_t::uiOffset },
+        { "uiScaleRatio", &constants_t::uiScaleRatio },
+    };
+
+    size_t sizeOf(kind_t kind) {
+        return kind == kind_t::Double ? sizeof(double) : sizeof(int32_t);
+    }
+
+    // Index into `names`, -1 for "any", -2 if it is neither
+    template <size_t N>
+    int parseName(const std::string& name, const char* const (&names)[N]) {
+        if (name == "any") {
+            return -1;
+        }
+        for (size_t i = 0; i < N; i++) {
+            if (name == names[i]) {
+                return (int)i;
+            }
+        }
+        return -2;
+    }
+
+    bool parseTo(const std::string& to, const constants_t& constants, double* value) {
+        for (const named_t& named : namedConstants) {
+            if (to == named.name) {
+                *value = constants.*named.field;
+                return true;
+            }
+        }
+        char* end = nullptr;
+        *value = strtod(to.c_str(), &end);
+        return !to.empty() && *end == '\0';
+    }
+
+    const Utils::section_t* sectionOf(const std::vector<Utils::section_t>& sections, uintptr_t address) {
+        for (const Utils::section_t& section : sections) {
+            if (address >= (uintptr_t)section.base && address < (uintptr_t)section.base + section.size) {
+                return &section;
+            }
+        }
+        return nullptr;
+    }
+
+    // How far back `startsInstruction` looks for the start of the function
+    constexpr uintptr_t syncRange = 0x10000;
+
+    /**
+     * Whether decoding forward from the last padding the compiler put between two
+     * functions lands on `at`. Where an immediate can be read as part of a longer
+     * instruction both decodes look fine on their own, only the function's start tells
+     * which one the game executes. Without padding within `syncRange` it is not known.
+     */
+    bool startsInstruction(const ZydisDecoder& decoder, const Utils::section_t& section, uintptr_t at) {
+        const uint8_t* base = section.base;
+        uintptr_t begin = (uintptr_t)base;
+        uintptr_t end = begin + section.size;
+        uintptr_t from = 0;
+        uintptr_t limit = at - begin > syncRange ? at - syncRange : begin;
+        for (uintptr_t i = at; i > limit; i--) {
+            // Two int3 in a row, a single one is as likely a byte of an operand
+            if (i - begin >= 2 && *(const uint8_t*)(i - 1) == 0xCC && *(const uint8_t*)(i - 2) == 0xCC
+                && *(const uint8_t*)i != 0xCC) {
+                from = i;
+                break;
+            }
+        }
+        if (!from && limit == begin) {
+            from = begin;
+        }
+        if (!from) {
+            return false;
+        }
+        ZydisDecodedInstruction instruction;
+        while (from < at) {
+            size_t length = std::min<size_t>(ZYDIS_MAX_INSTRUCTION_LENGTH, end - from);
+            from += ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(&decoder, nullptr, (const void*)from, length, &instruction))
+                ? instruction.length : 1;
+        }
+        return from == at;
+    }
+
+    /**
+     * Finds the instruction a 32-bit operand at `operand` belongs to. x86 can not be
+     * decoded backwards, so every start up to the longest instruction before it is
+     * decoded and the closest one that puts an immediate, or with `displacement` also
+     * a displacement, exactly on `operand` wins, once `startsInstruction` confirms the
+     * game really executes an instruction there.
+     */
+    bool decodeAround(const ZydisDecoder& decoder, const Utils::section_t& section, uintptr_t operand, bool displacement,
+        uintptr_t* start, ZydisDecodedInstruction* instruction, ZydisDecodedOperand* operands) {
+        uintptr_t begin = (uintptr_t)section.base;
+        uintptr_t end = begin + section.size;
+        for (uintptr_t back = 1; back < ZYDIS_MAX_INSTRUCTION_LENGTH && back <= operand - begin; back++) {
+            uintptr_t at = operand - back;
+            size_t length = std::min<size_t>(ZYDIS_MAX_INSTRUCTION_LENGTH, end - at);
+            if (!ZYAN_SUCCESS(ZydisDecoderDecodeFull(&decoder, (const void*)at, length, instruction, operands))
+                || instruction->length < back + sizeof(int32_t)) {
+                continue;
+            }
+            bool found = displacement && instruction->raw.disp.size == 32 && instruction->raw.disp.offset == back;
+            for (const auto& imm : instruction->raw.imm) {
+                // A relative operand is a branch distance that only happens to look like the constant
+                found |= imm.size == 32 && imm.offset == back && !imm.is_relative;
+            }
+            if (found && startsInstruction(decoder, section, at)) {
+                *start = at;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    use_t classify(const ZydisDecodedInstruction& instruction, const ZydisDecodedOperand* operands) {
+        switch (instruction.mnemonic) {
+        case ZYDIS_MNEMONIC_MOV:
+        case ZYDIS_MNEMONIC_MOVD:
+        case ZYDIS_MNEMONIC_MOVQ:
+        case ZYDIS_MNEMONIC_MOVSS:
+        case ZYDIS_MNEMONIC_MOVSD:
+            return operands[0].type == ZYDIS_OPERAND_TYPE_MEMORY ? use_t::Store : use_t::Load;
+        case ZYDIS_MNEMONIC_FLD:
+        case ZYDIS_MNEMONIC_FILD:
+        case ZYDIS_MNEMONIC_CVTSS2SD:
+        case ZYDIS_MNEMONIC_CVTSD2SS:
+        case ZYDIS_MNEMONIC_CVTSI2SS:
+        case ZYDIS_MNEMONIC_CVTSI2SD:
+            return use_t::Load;
+        case ZYDIS_MNEMONIC_PUSH:
+            return use_t::Push;
+        case ZYDIS_MNEMONIC_CMP:
+        case ZYDIS_MNEMONIC_TEST:
+        case ZYDIS_MNEMONIC_FCOM:
+        case ZYDIS_MNEMONIC_FCOMP:
+        case ZYDIS_MNEMONIC_FICOM:
+        case ZYDIS_MNEMONIC_FICOMP:
+        case ZYDIS_MNEMONIC_COMISS:
+        case ZYDIS_MNEMONIC_COMISD:
+        case ZYDIS_MNEMONIC_UCOMISS:
+        case ZYDIS_MNEMONIC_UCOMISD:
+            return use_t::Compare;
+        case ZYDIS_MNEMONIC_ADD:
+        case ZYDIS_MNEMONIC_SUB:
+        case ZYDIS_MNEMONIC_IMUL:
+        case ZYDIS_MNEMONIC_FADD:
+        case ZYDIS_MNEMONIC_FSUB:
+        case ZYDIS_MNEMONIC_FSUBR:
+        case ZYDIS_MNEMONIC_FMUL:
+        case ZYDIS_MNEMONIC_FDIV:
+        case ZYDIS_MNEMONIC_FDIVR:
+        case ZYDIS_MNEMONIC_FIADD:
+        case ZYDIS_MNEMONIC_FIMUL:
+        case ZYDIS_MNEMONIC_FIDIV:
+        case ZYDIS_MNEMONIC_ADDSS:
+        case ZYDIS_MNEMONIC_SUBSS:
+        case ZYDIS_MNEMONIC_MULSS:
+        case ZYDIS_MNEMONIC_DIVSS:
+        case ZYDIS_MNEMONIC_ADDSD:
+        case ZYDIS_MNEMONIC_SUBSD:
+        case ZYDIS_MNEMONIC_MULSD:
+        case ZYDIS_MNEMONIC_DIVSD:
+        case ZYDIS_MNEMONIC_MINSS:
+        case ZYDIS_MNEMONIC_MAXSS:
+            return use_t::Arithmetic;
+        default:
+            return use_t::Other;
+        }
+    }
+
+    bool overlaps(const reference_t& reference, const std::vector<Utils::codeRange_t>& ranges) {
+        for (const Utils::codeRange_t& range : ranges) {
+            if (reference.instruction < range.base + range.size && range.base < reference.operand + sizeof(int32_t)) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+namespace Retarget
+{
+    std::vector<reference_t> index(HMODULE module, const char* cachePath, unsigned threads) {
+        std::vector<Utils::section_t> sections = Utils::getSections(module);
+        ZydisDecoder decoder;
+        ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LEGACY_32, ZYDIS_STACK_WIDTH_32);
+        ZydisDecodedInstruction instruction;
+        ZydisDecodedOperand operands[ZYDIS_MAX_OPERAND_COUNT];
+        std::vector<reference_t> references;
+
+        std::vector<std::vector<uint64_t>> hits;
+        Utils::cachedPatternScan(module, constantSignatures, &hits, cachePath, threads);
+
+        std::vector<uintptr_t> data;
+        std::vector<const constant_t*> dataConstants;
+        for (size_t i = 0; i < std::size(constants); i++) {
+            const constant_t& constant = constants[i];
+            for (uint64_t hit : hits[i]) {
+                if (!constant.immediate) {
+                    // The compiler aligns its constants, anything else is part of unrelated data
+                    if (hit % sizeOf(constant.kind) == 0) {
+                        data.push_back((uintptr_t)hit);
+                        dataConstants.push_back(&constant);
+                    }
+                    continue;
+                }
+                const Utils::section_t* section = sectionOf(sections, (uintptr_t)hit);
+                uintptr_t start;
+                if (section && decodeAround(decoder, *section, (uintptr_t)hit, false, &start, &instruction, operands)) {
+                    references.push_back({ start, (uintptr_t)hit, 0, constant.value, constant.kind,
+                        classify(instruction, operands), instruction.mnemonic });
+                }
+            }
+        }
+
+        // Every constant in .rdata is found by its address, one 4 byte pattern each in one more pass.
+        // The pattern text is the key of the offset cache, storage has to outlive the scan
+        static constexpr uint8_t mask[4] = { 0xFF, 0xFF, 0xFF, 0xFF };
+        std::vector<std::array<uint8_t, 4>> addressBytes(data.size());
+        std::vector<std::string> texts(data.size());
+        std::vector<Utils::signature_t> readerSignatures;
+        for (size_t i = 0; i < data.size(); i++) {
+            uint32_t address = (uint32_t)data[i];
+            memcpy(addressBytes[i].data(), &address, sizeof(address));
+            texts[i] = Utils::bytesToString(addressBytes[i].data(), addressBytes[i].size());
+            Utils::pattern_t pattern{ addressBytes[i].data(), mask, addressBytes[i].size(), 0, 0, true, texts[i].c_str() };
+            Utils::detail::selectAnchors(pattern.bytes, pattern.mask, pattern.size, &pattern.anchor, &pattern.anchor2, &pattern.wildcardOnly);
+            readerSignatures.push_back({ pattern });
+        }
+        std::vector<std::vector<uint64_t>> readers;
+        if (!readerSignatures.empty()) {
+            Utils::cachedPatternScan(module, readerSignatures, &readers, (std::string(cachePath) + ".readers").c_str(), threads);
+        }
+        for (size_t i = 0; i < readers.size(); i++) {
+            for (uint64_t hit : readers[i]) {
+                const Utils::section_t* section = sectionOf(sections, (uintptr_t)hit);
+                uintptr_t start;
+                if (section && decodeAround(decoder, *section, (uintptr_t)hit, true, &start, &instruction, operands)) {
+                    references.push_back({ start, (uintptr_t)hit, data[i], dataConstants[i]->value, dataConstants[i]->kind,
+                        classify(instruction, operands), instruction.mnemonic });
+                }
+            }
+        }
+
+        std::sort(references.begin(), references.end(), [](const reference_t& a, const reference_t& b) {
+            return a.instruction != b.instruction ? a.instruction < b.instruction : a.operand < b.operand;
+        });
+        return references;
+    }
+
+    std::vector<applied_t> apply(HMODULE module, const std::vector<reference_t>& references,
+        const std::vector<retargetRule_t>& rules, const constants_t& constants,
+        const std::vector<Utils::codeRange_t>& avoid, bool* committed) {
+        std::vector<applied_t> results;
+        std::vector<int> kinds;
+        std::vector<int> uses;
+        for (const retargetRule_t& rule : rules) {
+            applied_t result{ &rule, true, 0.0, 0, 0 };
+            kinds.push_back(parseName(rule.kind, kindNames));
+            uses.push_back(parseName(rule.use, useNames));
+            result.valid = kinds.back() != -2 && uses.back() != -2 && parseTo(rule.to, constants, &result.to);
+            results.push_back(result);
+        }
+
+        // First matching rule wins
+        std::vector<std::pair<const reference_t*, size_t>> picks;
+        size_t copies = 0;
+        for (const reference_t& reference : references) {
+            for (size_t i = 0; i < rules.size(); i++) {
+                const retargetRule_t& rule = rules[i];
+                if (!results[i].valid || rule.value != reference.value
+                    || (kinds[i] != -1 && kinds[i] != (int)reference.kind)
+                    || (uses[i] != -1 && uses[i] != (int)reference.use)
+                    || (rule.rva && rule.rva != reference.instruction - (uintptr_t)module)) {
+                    continue;
+                }
+                if (overlaps(reference, avoid)) {
+                    results[i].skipped++;
+                } else {
+                    picks.push_back({ &reference, i });
+                    copies += reference.data != 0;
+                }
+                break;
+            }
+        }
+
+        // Copies of the .rdata constants picked, one 8 byte slot per kind and value, never freed
+        // once committed since the game reads them from then on
+        uint8_t* pool = nullptr;
+        if (copies) {
+            pool = (uint8_t*)VirtualAlloc(nullptr, copies * sizeof(double), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+            if (!pool) {
+                *committed = false;
+                return results;
+            }
+        }
+        std::map<std::pair<kind_t, double>, uintptr_t> slots;
+
+        Utils::PatchTransaction transaction;
+        for (const auto& [reference, rule] : picks) {
+            double to = results[rule].to;
+            int32_t integer = (int32_t)std::lround(to);
+            float single = (float)to;
+            uint8_t bytes[sizeof(double)];
+            if (reference->kind == kind_t::Int) {
+                memcpy(bytes, &integer, sizeof(integer));
+            } else if (reference->kind == kind_t::Float) {
+                memcpy(bytes, &single, sizeof(single));
+            } else {
+                memcpy(bytes, &to, sizeof(to));
+            }
+            if (!reference->data) {
+                transaction.add(reference->operand, bytes, sizeof(int32_t));
+            } else {
+                auto [slot, added] = slots.try_emplace({ reference->kind, to }, (uintptr_t)pool + slots.size() * sizeof(double));
+                if (added) {
+                    memcpy((void*)slot->second, bytes, sizeOf(reference->kind));
+                }
+                // 32-bit image, every address fits the displacement
+                uint32_t address = (uint32_t)slot->second;
+                transaction.add(reference->operand, (const uint8_t*)&address, sizeof(address));
+            }
+            results[rule].matched++;
+        }
+
+        *committed = transaction.size() == 0 || transaction.commit();
+        if (!*committed) {
+            if (pool) {
+                VirtualFree(pool, 0, MEM_RELEASE);
+            }
+            for (applied_t& result : results) {
+                result.matched = 0;
+            }
+        }
+        return results;
+    }
+
+    bool writeCsv(const char* path, HMODULE module, const std::vector<reference_t>& references) {
+        std::ofstream file(path, std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+        file << "rva,value,kind,use,mnemonic,data_rva\n";
+        for (const reference_t& reference : references) {
+            file << std::format("0x{:X},{},{},{},{},", reference.instruction - (uintptr_t)module, reference.value,
+                kindName(reference.kind), useName(reference.use), ZydisMnemonicGetString(reference.mnemonic));
+            if (reference.data) {
+                file << std::format("0x{:X}", reference.data - (uintptr_t)module);
+            }
+            file << "\n";
+        }
+        return (bool)file;
+    }
+
+    const char* kindName(kind_t kind) {
+        return kindNames[(size_t)kind];
+    }
+
+    const char* useName(use_t use) {
+        return useNames[(size_t)use];
+    }
+}
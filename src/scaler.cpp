@@ -0,0 +1,322 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Windows.h>
+#include <d3d9.h>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "scaler.hpp"
+
+namespace
+{
+    // Dynamic scaling steps down above, and up below, these fractions of the target frame time
+    constexpr double overBudget = 1.05;
+    constexpr double underBudget = 0.85;
+
+    float current = Scaler::maxScale;
+    bool isDynamic = false;
+    double targetMs = 0.0;
+    LONGLONG frequency = 0;     // QPC ticks per second
+    LONGLONG lastPresent = 0;   // QPC ticks, 0 until the first frame
+    double frameMsSum = 0.0;
+    int frames = 0;
+
+    // Owned by the swap chain and valid until the next Reset, no reference is kept
+    IDirect3DSurface9* backBuffer = nullptr;
+    D3DSURFACE_DESC backBufferDesc{};
+    IDirect3DSurface9* upscaleTarget = nullptr;
+    bool onBackBuffer = true;   // Reset and device creation bind the backbuffer
+
+    // Scaled copies of pre-transformed draws, reused so a HUD draw does not allocate
+    std::vector<uint8_t> vertexCopy;
+    std::vector<uint8_t> indexCopy;
+
+    LONGLONG now() {
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        return counter.QuadPart;
+    }
+
+    LONG scaled(LONG value) {
+        return (LONG)((float)value * current + 0.5f);
+    }
+
+    bool findBackBuffer(IDirect3DDevice9* device) {
+        if (!backBuffer) {
+            IDirect3DSurface9* surface = nullptr;
+            if (SUCCEEDED(device->GetBackBuffer(0, 0, D3DBACKBUFFER_TYPE_MONO, &surface))) {
+                surface->GetDesc(&backBufferDesc);
+                backBuffer = surface;
+                surface->Release();
+            }
+        }
+        return backBuffer != nullptr;
+    }
+
+    void setFullViewport(IDirect3DDevice9* device) {
+        // Goes through the SetViewport hook, which scales it
+        D3DVIEWPORT9 full{ 0, 0, backBufferDesc.Width, backBufferDesc.Height, 0.0f, 1.0f };
+        device->SetViewport(&full);
+    }
+
+    // Offset of the pre-transformed position in a stream 0 vertex, -1 if the draw is transformed by the viewport
+    int transformedPosition(IDirect3DDevice9* device) {
+        DWORD fvf = 0;
+        if (SUCCEEDED(device->GetFVF(&fvf)) && fvf) {
+            return (fvf & D3DFVF_POSITION_MASK) == D3DFVF_XYZRHW ? 0 : -1;
+        }
+        IDirect3DVertexDeclaration9* declaration = nullptr;
+        if (FAILED(device->GetVertexDeclaration(&declaration)) || !declaration) {
+            return -1;
+        }
+        D3DVERTEXELEMENT9 elements[MAXD3DDECLLENGTH + 1];
+        UINT count = MAXD3DDECLLENGTH + 1;
+        int offset = -1;
+        if (SUCCEEDED(declaration->GetDeclaration(elements, &count))) {
+            for (UINT i = 0; i < count && elements[i].Stream != 0xFF; i++) {
+                if (elements[i].Usage == D3DDECLUSAGE_POSITIONT && elements[i].Stream == 0) {
+                    offset = elements[i].Offset;
+                    break;
+                }
+            }
+        }
+        declaration->Release();
+        return offset;
+    }
+
+    // Moves the positions in `vertexCopy` into the scaled region
+    const void* scaleCopy(UINT stride, int position) {
+        for (size_t at = (size_t)position; at + 2 * sizeof(float) <= vertexCopy.size(); at += stride) {
+            float* xy = reinterpret_cast<float*>(vertexCopy.data() + at);
+            xy[0] *= current;
+            xy[1] *= current;
+        }
+        return vertexCopy.data();
+    }
+
+    // Copies `bytes` from `offset` of a buffer the game may read back, false if it is write only
+    template <typename Buffer, typename Desc>
+    bool readBuffer(Buffer* buffer, UINT offset, UINT bytes, std::vector<uint8_t>& copy, Desc& desc) {
+        void* data = nullptr;
+        if (FAILED(buffer->GetDesc(&desc)) || (desc.Usage & D3DUSAGE_WRITEONLY) || offset + bytes > desc.Size
+            || FAILED(buffer->Lock(offset, bytes, &data, D3DLOCK_READONLY))) {
+            return false;
+        }
+        const uint8_t* start = static_cast<const uint8_t*>(data);
+        copy.assign(start, start + bytes);
+        buffer->Unlock();
+        return true;
+    }
+
+    // Draws a vertex buffer draw from a scaled copy, false to let the game's call through unscaled
+    bool drawScaled(const Render::draw_t& draw, int position, IDirect3DVertexBuffer9* vertices, UINT offset, UINT stride,
+        IDirect3DIndexBuffer9* indices) {
+        if ((UINT)position + 2 * sizeof(float) > stride || draw.baseVertex < 0) {
+            return false;
+        }
+        // Indexed draws read from `baseVertex` up to the last vertex their indices reach
+        UINT first = draw.indexed ? (UINT)draw.baseVertex : draw.start;
+        UINT count = draw.indexed ? draw.minIndex + draw.vertexCount : Render::primitiveVertices(draw.type, draw.primitives);
+        D3DVERTEXBUFFER_DESC vertexDesc;
+        if (!count || !readBuffer(vertices, offset + first * stride, count * stride, vertexCopy, vertexDesc)) {
+            return false;
+        }
+        D3DINDEXBUFFER_DESC indexDesc{};
+        if (draw.indexed) {
+            UINT indexSize = 0;
+            if (indices && SUCCEEDED(indices->GetDesc(&indexDesc))) {
+                indexSize = indexDesc.Format == D3DFMT_INDEX32 ? 4 : 2;
+            }
+            UINT indexCount = Render::primitiveVertices(draw.type, draw.primitives);
+            if (!indexSize || !indexCount
+                || !readBuffer(indices, draw.start * indexSize, indexCount * indexSize, indexCopy, indexDesc)) {
+                return false;
+            }
+        }
+        const void* scaledVertices = scaleCopy(stride, position);
+
+        // The UP draws unbind stream 0 and the indices, both are put back for the game's next draw
+        Render::Direct scope;
+        if (draw.indexed) {
+            draw.device->DrawIndexedPrimitiveUP(draw.type, draw.minIndex, draw.vertexCount, draw.primitives,
+                indexCopy.data(), indexDesc.Format, scaledVertices, stride);
+            draw.device->SetIndices(indices);
+        }
+        else {
+            draw.device->DrawPrimitiveUP(draw.type, draw.primitives, scaledVertices, stride);
+        }
+        draw.device->SetStreamSource(0, vertices, offset, stride);
+        return true;
+    }
+
+    void step(double frameMs) {
+        frameMsSum += frameMs;
+        if (++frames < Scaler::evaluateFrames) {
+            return;
+        }
+        double average = frameMsSum / frames;
+        frameMsSum = 0.0;
+        frames = 0;
+        if (average > targetMs * overBudget) {
+            current = std::max(Scaler::minScale, current - Scaler::scaleStep);
+        }
+        else if (average < targetMs * underBudget) {
+            current = std::min(Scaler::maxScale, current + Scaler::scaleStep);
+        }
+    }
+}
+
+namespace Scaler
+{
+    void configure(float scale, bool dynamic, double targetFps) {
+        current = std::clamp(scale, minScale, maxScale);
+        isDynamic = dynamic && targetFps > 0.0;
+        targetMs = targetFps > 0.0 ? 1000.0 / targetFps : 0.0;
+        LARGE_INTEGER counter;
+        QueryPerformanceFrequency(&counter);
+        frequency = counter.QuadPart;
+        lastPresent = 0;
+        frameMsSum = 0.0;
+        frames = 0;
+    }
+
+    float scale() {
+        return current;
+    }
+
+    void present(Render::present_t& present, double waitedMs) {
+        IDirect3DDevice9* device = present.device;
+        if (current < maxScale && findBackBuffer(device)) {
+            if (!upscaleTarget) {
+                device->CreateRenderTarget(backBufferDesc.Width, backBufferDesc.Height, backBufferDesc.Format,
+                    D3DMULTISAMPLE_NONE, 0, FALSE, &upscaleTarget, NULL);
+            }
+            // A surface cannot be stretched onto itself, go through the offscreen target
+            RECT rendered{ 0, 0, scaled((LONG)backBufferDesc.Width), scaled((LONG)backBufferDesc.Height) };
+            bool ok = upscaleTarget
+                && SUCCEEDED(device->StretchRect(backBuffer, &rendered, upscaleTarget, NULL, D3DTEXF_LINEAR))
+                && SUCCEEDED(device->StretchRect(upscaleTarget, NULL, backBuffer, NULL, D3DTEXF_POINT));
+            if (!ok) {
+                // e.g. a multisampled backbuffer the driver cannot stretch, render at full size instead
+                current = maxScale;
+                isDynamic = false;
+                if (onBackBuffer) {
+                    setFullViewport(device);
+                }
+            }
+        }
+
+        LONGLONG time = now();
+        if (isDynamic && lastPresent) {
+            float before = current;
+            step((double)(time - lastPresent) * 1000.0 / (double)frequency - waitedMs);
+            // The game may not set a viewport before its first draw, keep the next frame in step
+            if (current != before && onBackBuffer && findBackBuffer(device)) {
+                setFullViewport(device);
+            }
+        }
+        lastPresent = time;
+
+        // Flip swap chains rotate their buffers in Present, look it up again next frame
+        backBuffer = nullptr;
+    }
+
+    void reset(IDirect3DDevice9* device) {
+        if (upscaleTarget) {
+            upscaleTarget->Release();
+            upscaleTarget = nullptr;
+        }
+        backBuffer = nullptr;
+        onBackBuffer = true;
+        lastPresent = 0;
+    }
+
+    void renderTarget(IDirect3DDevice9* device, DWORD index, IDirect3DSurface9* surface) {
+        if (index != 0) {
+            return;
+        }
+        onBackBuffer = findBackBuffer(device) && surface == backBuffer;
+        if (onBackBuffer && current < maxScale) {
+            setFullViewport(device);
+        }
+    }
+
+    void viewport(IDirect3DDevice9* device, D3DVIEWPORT9& viewport) {
+        if (onBackBuffer && current < maxScale) {
+            viewport.X = (DWORD)scaled((LONG)viewport.X);
+            viewport.Y = (DWORD)scaled((LONG)viewport.Y);
+            viewport.Width = std::max<DWORD>(1, (DWORD)scaled((LONG)viewport.Width));
+            viewport.Height = std::max<DWORD>(1, (DWORD)scaled((LONG)viewport.Height));
+        }
+    }
+
+    void scissorRect(IDirect3DDevice9* device, RECT& rect) {
+        if (onBackBuffer && current < maxScale) {
+            rect.left = scaled(rect.left);
+            rect.top = scaled(rect.top);
+            rect.right = scaled(rect.right);
+            rect.bottom = scaled(rect.bottom);
+        }
+    }
+
+    bool draw(const Render::draw_t& draw) {
+        if (!onBackBuffer || current >= maxScale) {
+            return false;
+        }
+        int position = transformedPosition(draw.device);
+        if (position < 0) {
+            return false;
+        }
+        IDirect3DVertexBuffer9* vertices = nullptr;
+        UINT offset = 0;
+        UINT stride = 0;
+        if (FAILED(draw.device->GetStreamSource(0, &vertices, &offset, &stride)) || !vertices) {
+            return false;
+        }
+        IDirect3DIndexBuffer9* indices = nullptr;
+        if (draw.indexed) {
+            draw.device->GetIndices(&indices);
+        }
+        bool drew = drawScaled(draw, position, vertices, offset, stride, indices);
+        if (indices) {
+            indices->Release();
+        }
+        vertices->Release();
+        return drew;
+    }
+
+    void drawUp(IDirect3DDevice9* device, UINT vertexCount, const void*& vertices, UINT stride) {
+        if (!onBackBuffer || current >= maxScale) {
+            return;
+        }
+        int position = transformedPosition(device);
+        if (position >= 0 && (UINT)position + 2 * sizeof(float) <= stride) {
+            const uint8_t* bytes = static_cast<const uint8_t*>(vertices);
+            vertexCopy.assign(bytes, bytes + (size_t)vertexCount * stride);
+            vertices = scaleCopy(stride, position);
+        }
+    }
+}
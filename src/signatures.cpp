@@ -0,0 +1,120 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Windows.h>
+#include <string>
+
+#include "signatures.hpp"
+
+namespace
+{
+    size_t distance(size_t a, size_t b) {
+        return a > b ? a - b : b - a;
+    }
+}
+
+std::vector<resolved_t> resolveSignatures(HMODULE exe, std::vector<std::vector<uint64_t>>* hits, const char* cachePath,
+    unsigned threads, bool* fromCache) {
+    // Modules in the order they first appear, nullptr is the game exe
+    std::vector<const char*> modules;
+    for (const std::vector<candidate_t>& candidates : signatureDatabase) {
+        for (const candidate_t& candidate : candidates) {
+            bool known = false;
+            for (const char* module : modules) {
+                known = known || sameModule(module, candidate.module);
+            }
+            if (!known) {
+                modules.push_back(candidate.module);
+            }
+        }
+    }
+
+    // One batched scan per module, candidates come back in the order databaseSignatures lists them
+    std::vector<std::vector<std::vector<uint64_t>>> moduleHits(modules.size());
+    bool cached = true;
+    for (size_t i = 0; i < modules.size(); i++) {
+        HMODULE module = modules[i] ? GetModuleHandleA(modules[i]) : exe;
+        std::vector<Utils::signature_t> flat = databaseSignatures(modules[i]);
+        if (!module) {
+            moduleHits[i].assign(flat.size(), {});
+            continue;
+        }
+        std::string path = modules[i] ? std::string(cachePath) + "." + modules[i] : std::string(cachePath);
+        cached &= Utils::cachedPatternScan(module, flat, &moduleHits[i], path.c_str(), threads);
+    }
+    if (fromCache) {
+        *fromCache = cached;
+    }
+
+    hits->assign(SignatureCount, {});
+    std::vector<resolved_t> resolved(SignatureCount, { nullptr, 0, 0, false });
+    std::vector<size_t> next(modules.size(), 0);
+    for (size_t id = 0; id < SignatureCount && id < signatureDatabase.size(); id++) {
+        const std::vector<candidate_t>& candidates = signatureDatabase[id];
+        const std::vector<uint64_t>* best = nullptr;
+        for (size_t c = 0; c < candidates.size(); c++) {
+            const candidate_t& candidate = candidates[c];
+            size_t m = 0;
+            while (!sameModule(modules[m], candidate.module)) {
+                m++;
+            }
+            const std::vector<uint64_t>& candidateHits = moduleHits[m][next[m]++];
+            if (candidateHits.empty()) {
+                continue;
+            }
+            resolved_t& current = resolved[id];
+            bool unique = candidateHits.size() == candidate.expectedHits;
+            bool better = !current.candidate
+                || (unique && !current.unique)
+                || (!unique && !current.unique && distance(candidateHits.size(), candidate.expectedHits)
+                    < distance(current.hits, current.candidate->expectedHits));
+            if (better) {
+                current = { &candidate, c, candidateHits.size(), unique };
+                best = &candidateHits;
+            }
+        }
+        if (best) {
+            for (uint64_t hit : *best) {
+                (*hits)[id].push_back(hit + (uint64_t)resolved[id].candidate->fixup);
+            }
+        }
+    }
+    return resolved;
+}
+
+std::vector<uint8_t> resolutionPatch(uint32_t width, uint32_t height, uint32_t offset) {
+    std::vector<uint8_t> code;
+    auto movImm32 = [&code](uint8_t opcode, uint32_t value) {
+        code.push_back(opcode);
+        code.insert(code.end(), (uint8_t*)&value, (uint8_t*)&value + sizeof(value));
+    };
+    movImm32(0xB8, width);          // mov eax, width
+    movImm32(0xBB, height << 4);    // mov ebx, height << 4
+    movImm32(0xB9, offset);         // mov ecx, offset
+    movImm32(0xBA, width);          // mov edx, width
+    movImm32(0xBE, height);         // mov esi, height
+    movImm32(0xBF, width);          // mov edi, width
+    code.push_back(0x90);           // nop
+    return code;
+}
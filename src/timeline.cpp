@@ -0,0 +1,147 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Windows.h>
+#include <atomic>
+#include <format>
+#include <fstream>
+#include <algorithm>
+
+#include "timeline.hpp"
+
+namespace
+{
+    typedef struct phase_t {
+        const char* name;
+        LONGLONG start;         // QPC ticks
+        LONGLONG end;           // QPC ticks, same as start for a mark
+    } phase_t;
+
+    typedef struct qpcClock_t {
+        LONGLONG frequency;     // QPC ticks per second
+        LONGLONG processStart;  // Process creation time in QPC ticks
+    } qpcClock_t;
+
+    phase_t phases[Timeline::maxPhases];
+    std::atomic<size_t> phaseCount = 0;
+
+    LONGLONG now() {
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        return counter.QuadPart;
+    }
+
+    const qpcClock_t& qpcClock() {
+        static const qpcClock_t clock = [] {
+            qpcClock_t clock{};
+            LARGE_INTEGER frequency;
+            QueryPerformanceFrequency(&frequency);
+            clock.frequency = frequency.QuadPart;
+
+            // Both FILETIMEs are in 100ns units, convert the age of the process to ticks
+            FILETIME creation, exit, kernel, user, current;
+            LONGLONG counter = now();
+            GetSystemTimePreciseAsFileTime(&current);
+            clock.processStart = counter;
+            if (GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+                ULARGE_INTEGER c{ { creation.dwLowDateTime, creation.dwHighDateTime } };
+                ULARGE_INTEGER n{ { current.dwLowDateTime, current.dwHighDateTime } };
+                LONGLONG age = n.QuadPart > c.QuadPart ? (LONGLONG)(n.QuadPart - c.QuadPart) : 0;
+                clock.processStart = counter - (LONGLONG)((double)age * clock.frequency / 10'000'000.0);
+            }
+            return clock;
+        }();
+        return clock;
+    }
+
+    double toMs(LONGLONG ticks) {
+        return (double)ticks * 1000.0 / (double)qpcClock().frequency;
+    }
+
+    void record(const char* name, LONGLONG start, LONGLONG end) {
+        size_t index = phaseCount.fetch_add(1, std::memory_order_relaxed);
+        if (index < Timeline::maxPhases) {
+            phases[index] = { name, start, end };
+        }
+    }
+
+    size_t recorded() {
+        return std::min(phaseCount.load(std::memory_order_acquire), Timeline::maxPhases);
+    }
+}
+
+namespace Timeline
+{
+    double sinceProcessStart() {
+        return toMs(now() - qpcClock().processStart);
+    }
+
+    void mark(const char* name) {
+        qpcClock();
+        LONGLONG time = now();
+        record(name, time, time);
+    }
+
+    Scope::Scope(const char* name) : name(name) {
+        qpcClock();
+        start = now();
+    }
+
+    Scope::~Scope() {
+        record(name, start, now());
+    }
+
+    std::string summary() {
+        std::string line;
+        LONGLONG last = qpcClock().processStart;
+        for (size_t i = 0; i < recorded(); i++) {
+            const phase_t& phase = phases[i];
+            if (!line.empty()) {
+                line += " | ";
+            }
+            if (phase.start == phase.end) {
+                line += std::format("{} @ {:.2f} ms", phase.name, toMs(phase.start - qpcClock().processStart));
+            } else {
+                line += std::format("{} {:.2f} ms", phase.name, toMs(phase.end - phase.start));
+            }
+            last = std::max(last, phase.end);
+        }
+        line += std::format(" | done @ {:.2f} ms", toMs(last - qpcClock().processStart));
+        return line;
+    }
+
+    bool writeCsv(const char* path) {
+        std::ofstream file(path, std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+        file << "phase,start_ms,duration_ms\n";
+        for (size_t i = 0; i < recorded(); i++) {
+            const phase_t& phase = phases[i];
+            file << std::format("{},{:.3f},{:.3f}\n", phase.name,
+                toMs(phase.start - qpcClock().processStart), toMs(phase.end - phase.start));
+        }
+        return (bool)file;
+    }
+}
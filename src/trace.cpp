@@ -0,0 +1,161 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Windows.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+
+#include "trace.hpp"
+
+namespace
+{
+    typedef struct header_t {
+        uint32_t magic;
+        uint32_t version;
+        int32_t width;
+        int32_t height;
+        uint32_t sites;         // Each a uint32_t length and the name, not terminated
+        uint32_t records;       // `record_t` as is, after the names
+    } header_t;
+
+#ifdef TRACE_HOOKS
+    const char* siteNames[Trace::maxSites];
+    size_t siteCount = 0;
+    std::mutex sitesMutex;
+    Trace::record_t records[Trace::maxRecords];
+    std::atomic<uint32_t> recordCount = 0;
+    int traceWidth = 0;
+    int traceHeight = 0;
+#endif
+}
+
+namespace Trace
+{
+    bool read(const char* path, trace_t* trace) {
+        std::ifstream file(path, std::ios::binary);
+        header_t header{};
+        if (!file.read((char*)&header, sizeof(header)) || header.magic != magic || header.version != version) {
+            return false;
+        }
+        trace->width = header.width;
+        trace->height = header.height;
+        trace->sites.clear();
+        for (uint32_t i = 0; i < header.sites; i++) {
+            uint32_t length = 0;
+            if (!file.read((char*)&length, sizeof(length))) {
+                return false;
+            }
+            std::string name(length, '\0');
+            if (!file.read(name.data(), length)) {
+                return false;
+            }
+            trace->sites.push_back(name);
+        }
+        trace->records.resize(header.records);
+        if (!file.read((char*)trace->records.data(), (std::streamsize)(header.records * sizeof(record_t)))) {
+            return false;
+        }
+        // A record of a site that is not in the table would index past it
+        return std::all_of(trace->records.begin(), trace->records.end(), [trace](const record_t& record) {
+            return record.site < trace->sites.size() && record.windows <= maxStores;
+        });
+    }
+
+#ifdef TRACE_HOOKS
+    uint16_t site(const char* name) {
+        std::lock_guard lock(sitesMutex);
+        if (siteCount == maxSites) {
+            return (uint16_t)maxSites;
+        }
+        siteNames[siteCount] = name;
+        return (uint16_t)siteCount++;
+    }
+
+    void setResolution(int width, int height) {
+        traceWidth = width;
+        traceHeight = height;
+    }
+
+    Scope::Scope(uint16_t site, const SafetyHookContext& ctx, const std::vector<Hook::store_t>& stores) : record(nullptr) {
+        // Checked first so a long session does not keep counting once the table is full
+        if (site >= maxSites || recordCount.load(std::memory_order_relaxed) >= maxRecords) {
+            return;
+        }
+        uint32_t index = recordCount.fetch_add(1, std::memory_order_relaxed);
+        if (index >= maxRecords) {
+            return;
+        }
+        record = &records[index];
+        record->site = site;
+        record->registers = { (uint32_t)ctx.eax, (uint32_t)ctx.ebx, (uint32_t)ctx.ecx, (uint32_t)ctx.edx,
+            (uint32_t)ctx.esi, (uint32_t)ctx.edi, (uint32_t)ctx.ebp, (uint32_t)ctx.esp };
+        record->windows = (uint16_t)std::min(stores.size(), maxStores);
+        for (size_t i = 0; i < record->windows; i++) {
+            window_t& window = record->window[i];
+            window.address = (uint32_t)(Hook::address(stores[i], ctx) - windowSize / 2);
+            memcpy(window.before, (const void*)(uintptr_t)window.address, windowSize);
+        }
+    }
+
+    Scope::~Scope() {
+        if (!record) {
+            return;
+        }
+        for (size_t i = 0; i < record->windows; i++) {
+            window_t& window = record->window[i];
+            memcpy(window.after, (const void*)(uintptr_t)window.address, windowSize);
+        }
+    }
+
+    bool dump(const char* path) {
+        uint32_t count = std::min(recordCount.load(std::memory_order_acquire), (uint32_t)maxRecords);
+        if (count == 0) {
+            return false;
+        }
+        HANDLE file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        size_t sites;
+        {
+            std::lock_guard lock(sitesMutex);
+            sites = siteCount;
+        }
+        header_t header{ magic, version, traceWidth, traceHeight, (uint32_t)sites, count };
+        DWORD written;
+        bool ok = WriteFile(file, &header, sizeof(header), &written, NULL);
+        for (size_t i = 0; i < sites; i++) {
+            uint32_t length = (uint32_t)strlen(siteNames[i]);
+            ok = ok && WriteFile(file, &length, sizeof(length), &written, NULL);
+            ok = ok && WriteFile(file, siteNames[i], length, &written, NULL);
+        }
+        ok = ok && WriteFile(file, records, (DWORD)(count * sizeof(record_t)), &written, NULL);
+        CloseHandle(file);
+        return ok;
+    }
+#endif
+}
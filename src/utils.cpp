@@ -27,10 +27,406 @@
 #include <format>
 #include <iostream>
 #include <sstream>
+#include <fstream>
 #include <cstdint>
+#include <cstring>
+#include <array>
+#include <algorithm>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
 #include <TlHelp32.h>
+#include <intrin.h>
+#include <immintrin.h>
 
 #include "utils.hpp"
+#include "signature.hpp"
+
+// GCC and Clang only emit SSE2/AVX2 instructions for functions that opt in,
+// MSVC emits any intrinsic regardless of /arch.
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_XSAVE __attribute__((target("xsave")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#define TARGET_XSAVE
+#endif
+
+namespace
+{
+    using Utils::pattern_t;
+
+    enum class simd_t {
+        None,
+        Sse2,
+        Avx2
+    };
+
+    // Storage for a pattern only known at runtime, `Signature` covers everything known at build time
+    typedef struct runtimePattern_t {
+        std::vector<uint8_t> bytes;
+        std::vector<uint8_t> mask;
+        pattern_t view;
+    } runtimePattern_t;
+
+    void parsePattern(const char* signature, runtimePattern_t* pattern) {
+        std::istringstream stream(signature);
+        std::string token;
+        while (stream >> token) {
+            if (token == "?" || token == "??") {
+                pattern->bytes.push_back(0x00);
+                pattern->mask.push_back(0x00);
+            } else {
+                int byte;
+                std::istringstream hexStream(token);
+                hexStream >> std::hex >> byte;
+                pattern->bytes.push_back((uint8_t)byte);
+                pattern->mask.push_back(0xFF);
+            }
+        }
+        pattern->view = { pattern->bytes.data(), pattern->mask.data(), pattern->bytes.size(), 0, 0, true, signature };
+        Utils::detail::selectAnchors(pattern->bytes.data(), pattern->mask.data(), pattern->bytes.size(),
+            &pattern->view.anchor, &pattern->view.anchor2, &pattern->view.wildcardOnly);
+    }
+
+    TARGET_XSAVE uint64_t readXcr0() {
+        return _xgetbv(0);
+    }
+
+    simd_t simdSupport() {
+        static const simd_t level = [] {
+            int info[4];
+            __cpuid(info, 0);
+            int maxLeaf = info[0];
+            __cpuid(info, 1);
+            bool sse2 = (info[3] & (1 << 26)) != 0;
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            bool avx = (info[2] & (1 << 28)) != 0;
+            bool avx2 = false;
+            if (maxLeaf >= 7) {
+                __cpuidex(info, 7, 0);
+                avx2 = (info[1] & (1 << 5)) != 0;
+            }
+            // The OS must also save the YMM registers on context switch
+            if (avx2 && avx && osxsave && (readXcr0() & 0x6) == 0x6) {
+                return simd_t::Avx2;
+            }
+            return sse2 ? simd_t::Sse2 : simd_t::None;
+        }();
+        return level;
+    }
+
+    inline bool matchAt(const uint8_t* data, const pattern_t& pattern) {
+        const uint8_t* b = pattern.bytes;
+        const uint8_t* m = pattern.mask;
+        for (size_t j = 0; j < pattern.size; j++) {
+            if ((data[j] & m[j]) != b[j]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void scanScalar(const uint8_t* data, size_t begin, size_t end, const pattern_t& pattern, std::vector<uint64_t>* address) {
+        for (size_t i = begin; i < end; i++) {
+            if (matchAt(&data[i], pattern)) {
+                address->push_back((uint64_t)&data[i]);
+            }
+        }
+    }
+
+    TARGET_SSE2 size_t scanSse2(const uint8_t* data, size_t positions, const pattern_t& pattern, std::vector<uint64_t>* address) {
+        const __m128i a1 = _mm_set1_epi8((char)pattern.bytes[pattern.anchor]);
+        const __m128i a2 = _mm_set1_epi8((char)pattern.bytes[pattern.anchor2]);
+        const uint8_t* p1 = data + pattern.anchor;
+        const uint8_t* p2 = data + pattern.anchor2;
+        size_t i = 0;
+        for (; i + 16 <= positions; i += 16) {
+            __m128i c1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p1 + i)), a1);
+            __m128i c2 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p2 + i)), a2);
+            unsigned bits = (unsigned)_mm_movemask_epi8(_mm_and_si128(c1, c2));
+            while (bits) {
+                unsigned long j;
+                _BitScanForward(&j, bits);
+                bits &= bits - 1;
+                if (matchAt(&data[i + j], pattern)) {
+                    address->push_back((uint64_t)&data[i + j]);
+                }
+            }
+        }
+        return i;
+    }
+
+    TARGET_AVX2 size_t scanAvx2(const uint8_t* data, size_t positions, const pattern_t& pattern, std::vector<uint64_t>* address) {
+        const __m256i a1 = _mm256_set1_epi8((char)pattern.bytes[pattern.anchor]);
+        const __m256i a2 = _mm256_set1_epi8((char)pattern.bytes[pattern.anchor2]);
+        const uint8_t* p1 = data + pattern.anchor;
+        const uint8_t* p2 = data + pattern.anchor2;
+        size_t i = 0;
+        for (; i + 32 <= positions; i += 32) {
+            __m256i c1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p1 + i)), a1);
+            __m256i c2 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p2 + i)), a2);
+            unsigned bits = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(c1, c2));
+            while (bits) {
+                unsigned long j;
+                _BitScanForward(&j, bits);
+                bits &= bits - 1;
+                if (matchAt(&data[i + j], pattern)) {
+                    address->push_back((uint64_t)&data[i + j]);
+                }
+            }
+        }
+        _mm256_zeroupper();
+        return i;
+    }
+
+    /**
+     * Scans `size` bytes starting at `data`. Same as the scalar scanner the last
+     * candidate position is `size - pattern length - 1`, so hits are identical.
+     * Anchors are compared 16/32 positions at a time and only candidates where
+     * both anchors match get the full masked compare.
+     */
+    void scanRegion(const uint8_t* data, size_t size, const pattern_t& pattern, std::vector<uint64_t>* address) {
+        if (pattern.size == 0 || size <= pattern.size) {
+            return;
+        }
+        size_t positions = size - pattern.size;
+        size_t done = 0;
+        if (!pattern.wildcardOnly) {
+            switch (simdSupport()) {
+            case simd_t::Avx2:
+                done = scanAvx2(data, positions, pattern, address);
+                break;
+            case simd_t::Sse2:
+                done = scanSse2(data, positions, pattern, address);
+                break;
+            default:
+                break;
+            }
+        }
+        scanScalar(data, done, positions, pattern, address);
+    }
+
+    typedef struct multiPattern_t {
+        std::vector<pattern_t> patterns;
+        std::array<std::vector<uint16_t>, 256> dispatch; // Anchor byte -> patterns anchored on it
+        std::vector<uint8_t> anchorBytes;                // Distinct anchor bytes
+        std::vector<size_t> ids;                         // Pattern -> index into the caller's hit list
+    } multiPattern_t;
+
+    // Past this many distinct anchor bytes the vector compares cost more than the table lookup
+    constexpr size_t maxVectorAnchors = 8;
+
+    multiPattern_t buildMultiPattern(const std::vector<pattern_t>& patterns, const std::vector<size_t>& ids) {
+        multiPattern_t multi{};
+        multi.patterns = patterns;
+        multi.ids = ids;
+        for (size_t i = 0; i < multi.patterns.size(); i++) {
+            const pattern_t& pattern = multi.patterns[i];
+            if (pattern.size == 0 || pattern.wildcardOnly) {
+                continue;
+            }
+            uint8_t byte = pattern.bytes[pattern.anchor];
+            if (multi.dispatch[byte].empty()) {
+                multi.anchorBytes.push_back(byte);
+            }
+            multi.dispatch[byte].push_back((uint16_t)i);
+        }
+        return multi;
+    }
+
+    inline void dispatchAt(const uint8_t* data, size_t size, size_t i, const multiPattern_t& multi, std::vector<std::vector<uint64_t>>* addresses) {
+        for (uint16_t index : multi.dispatch[data[i]]) {
+            const pattern_t& pattern = multi.patterns[index];
+            if (i < pattern.anchor) {
+                continue;
+            }
+            size_t start = i - pattern.anchor;
+            if (start + pattern.size < size
+                && data[start + pattern.anchor2] == pattern.bytes[pattern.anchor2]
+                && matchAt(&data[start], pattern)) {
+                (*addresses)[multi.ids[index]].push_back((uint64_t)&data[start]);
+            }
+        }
+    }
+
+    TARGET_SSE2 size_t multiScanSse2(const uint8_t* data, size_t size, const multiPattern_t& multi, std::vector<std::vector<uint64_t>>* addresses) {
+        __m128i anchors[maxVectorAnchors];
+        size_t count = multi.anchorBytes.size();
+        for (size_t k = 0; k < count; k++) {
+            anchors[k] = _mm_set1_epi8((char)multi.anchorBytes[k]);
+        }
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            __m128i block = _mm_loadu_si128((const __m128i*)(data + i));
+            __m128i any = _mm_setzero_si128();
+            for (size_t k = 0; k < count; k++) {
+                any = _mm_or_si128(any, _mm_cmpeq_epi8(block, anchors[k]));
+            }
+            unsigned bits = (unsigned)_mm_movemask_epi8(any);
+            while (bits) {
+                unsigned long j;
+                _BitScanForward(&j, bits);
+                bits &= bits - 1;
+                dispatchAt(data, size, i + j, multi, addresses);
+            }
+        }
+        return i;
+    }
+
+    TARGET_AVX2 size_t multiScanAvx2(const uint8_t* data, size_t size, const multiPattern_t& multi, std::vector<std::vector<uint64_t>>* addresses) {
+        __m256i anchors[maxVectorAnchors];
+        size_t count = multi.anchorBytes.size();
+        for (size_t k = 0; k < count; k++) {
+            anchors[k] = _mm256_set1_epi8((char)multi.anchorBytes[k]);
+        }
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            __m256i block = _mm256_loadu_si256((const __m256i*)(data + i));
+            __m256i any = _mm256_setzero_si256();
+            for (size_t k = 0; k < count; k++) {
+                any = _mm256_or_si256(any, _mm256_cmpeq_epi8(block, anchors[k]));
+            }
+            unsigned bits = (unsigned)_mm256_movemask_epi8(any);
+            while (bits) {
+                unsigned long j;
+                _BitScanForward(&j, bits);
+                bits &= bits - 1;
+                dispatchAt(data, size, i + j, multi, addresses);
+            }
+        }
+        _mm256_zeroupper();
+        return i;
+    }
+
+    /**
+     * Single pass over `size` bytes for every pattern at once. Each byte is
+     * looked up in the anchor dispatch table and only the patterns anchored on
+     * that byte get the full masked compare. Hits per pattern stay in ascending
+     * order and match what `scanRegion` returns for that pattern alone.
+     */
+    void multiScanRegion(const uint8_t* data, size_t size, const multiPattern_t& multi, std::vector<std::vector<uint64_t>>* addresses) {
+        size_t done = 0;
+        if (!multi.anchorBytes.empty() && multi.anchorBytes.size() <= maxVectorAnchors) {
+            switch (simdSupport()) {
+            case simd_t::Avx2:
+                done = multiScanAvx2(data, size, multi, addresses);
+                break;
+            case simd_t::Sse2:
+                done = multiScanSse2(data, size, multi, addresses);
+                break;
+            default:
+                break;
+            }
+        }
+        for (size_t i = done; i < size; i++) {
+            dispatchAt(data, size, i, multi, addresses);
+        }
+
+        // Patterns made of nothing but wildcards have no anchor to dispatch on
+        for (size_t i = 0; i < multi.patterns.size(); i++) {
+            if (multi.patterns[i].wildcardOnly) {
+                scanRegion(data, size, multi.patterns[i], &(*addresses)[multi.ids[i]]);
+            }
+        }
+    }
+
+    /**
+     * Splits [base, base + size) into runs of committed, readable memory so the
+     * scanners never fault on guard, no-access or reserved pages.
+     */
+    std::vector<std::pair<const uint8_t*, size_t>> readableRuns(const uint8_t* base, size_t size) {
+        constexpr DWORD readable = PAGE_READONLY | PAGE_READWRITE | PAGE_WRITECOPY
+            | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+        std::vector<std::pair<const uint8_t*, size_t>> runs;
+        const uint8_t* current = base;
+        const uint8_t* end = base + size;
+        while (current < end) {
+            MEMORY_BASIC_INFORMATION mbi{};
+            if (!VirtualQuery(current, &mbi, sizeof(mbi))) {
+                break;
+            }
+            const uint8_t* regionEnd = std::min((const uint8_t*)mbi.BaseAddress + mbi.RegionSize, end);
+            bool ok = mbi.State == MEM_COMMIT && (mbi.Protect & readable) && !(mbi.Protect & PAGE_GUARD);
+            if (ok) {
+                if (!runs.empty() && runs.back().first + runs.back().second == current) {
+                    runs.back().second += regionEnd - current;
+                } else {
+                    runs.push_back({ current, (size_t)(regionEnd - current) });
+                }
+            }
+            current = regionEnd;
+        }
+        return runs;
+    }
+
+    uint64_t fnv1a(const char* string, uint64_t hash = 0xCBF29CE484222325ull) {
+        for (; string && *string; string++) {
+            hash = (hash ^ (uint8_t)*string) * 0x100000001B3ull;
+        }
+        return hash;
+    }
+
+    typedef struct chunk_t {
+        size_t group;            // Index of the multi pattern scanned in this chunk
+        const uint8_t* base;
+        size_t window;           // Bytes handed to the scanner, owned bytes plus overlap
+        size_t owned;            // Hits must start within the first `owned` bytes
+    } chunk_t;
+
+    // Small enough to spread .text over the workers, big enough to keep per chunk overhead negligible
+    constexpr size_t minChunkSize = 256 * 1024;
+
+    /**
+     * Splits a readable run into chunks for the parallel scanner. Neighbouring
+     * chunks overlap by `overlap` bytes, the longest pattern length minus one,
+     * plus the one byte the scanners never treat as a start position, so every
+     * position the run would be scanned at is scanned in exactly one chunk.
+     */
+    void splitChunks(size_t group, const uint8_t* base, size_t size, size_t overlap, std::vector<chunk_t>* chunks) {
+        for (size_t offset = 0; offset < size; offset += minChunkSize) {
+            size_t owned = std::min(minChunkSize, size - offset);
+            size_t window = std::min(owned + overlap + 1, size - offset);
+            if (offset + owned == size) {
+                window = owned;
+            }
+            chunks->push_back({ group, base + offset, window, owned });
+        }
+    }
+
+    // Changing a signature or the section it lives in invalidates only its own cache entry
+    uint64_t signatureKey(const Utils::signature_t& signature) {
+        return fnv1a(signature.section ? signature.section : "", fnv1a(signature.pattern.text));
+    }
+
+    // Threads suspended by `suspendAllThreads`, owned until `resumeAllThreads`
+    std::vector<HANDLE> suspendedThreads;
+
+    // How often a thread caught in a range about to be patched is let run before giving up
+    constexpr int maxRangeRetries = 64;
+
+    bool insideRange(HANDLE thread, const std::vector<Utils::codeRange_t>& ranges) {
+        CONTEXT context{};
+        context.ContextFlags = CONTEXT_CONTROL;
+        // Also waits for the suspension to take effect, SuspendThread alone is asynchronous
+        if (!GetThreadContext(thread, &context)) {
+            return false;
+        }
+#ifdef _WIN64
+        uintptr_t ip = (uintptr_t)context.Rip;
+#else
+        uintptr_t ip = (uintptr_t)context.Eip;
+#endif
+        for (const Utils::codeRange_t& range : ranges) {
+            if (ip > range.base && ip < range.base + range.size) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
 
 namespace Utils
 {
@@ -74,6 +470,14 @@ namespace Utils
         return {};
     }
 
+    void patch(uintptr_t address, const uint8_t* bytes, size_t size)
+    {
+        DWORD oldProtect;
+        VirtualProtect((LPVOID)address, size, PAGE_EXECUTE_READWRITE, &oldProtect);
+        memcpy((LPVOID)address, bytes, size);
+        VirtualProtect((LPVOID)address, size, oldProtect, &oldProtect);
+    }
+
     void patch(uintptr_t address, const char* pattern)
     {
         static auto pattern_to_byte = [](const char* pattern) {
@@ -93,7 +497,135 @@ namespace Utils
         VirtualProtect((LPVOID)address, patternBytes.size(), oldProtect, &oldProtect);
     }
 
-    void patternScan(void* module, const char* signature, std::vector<uint64_t>* address)
+    void PatchTransaction::add(uintptr_t address, const uint8_t* bytes, size_t size)
+    {
+        writes.push_back({ address, std::vector<uint8_t>(bytes, bytes + size), {} });
+    }
+
+    void PatchTransaction::add(uintptr_t address, const char* pattern)
+    {
+        auto bytes = std::vector<uint8_t>{};
+        auto current = const_cast<char*>(pattern);
+        auto end = const_cast<char*>(pattern) + strlen(pattern);
+        while (current < end) {
+            char* next;
+            unsigned long value = strtoul(current, &next, 16);
+            if (next == current) {
+                break;
+            }
+            bytes.push_back((uint8_t)value);
+            current = next;
+        }
+        add(address, bytes.data(), bytes.size());
+    }
+
+    bool PatchTransaction::commit()
+    {
+        if (isCommitted || !apply(false)) {
+            return false;
+        }
+        isCommitted = true;
+        return true;
+    }
+
+    bool PatchTransaction::rollback()
+    {
+        if (!isCommitted || !apply(true)) {
+            return false;
+        }
+        isCommitted = false;
+        return true;
+    }
+
+    bool PatchTransaction::apply(bool restore)
+    {
+        if (writes.empty()) {
+            return true;
+        }
+        static const uintptr_t pageSize = [] {
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            return (uintptr_t)info.dwPageSize;
+        }();
+
+        // Every page touched by a write, sorted and unique
+        std::vector<uintptr_t> pages;
+        uintptr_t low = UINTPTR_MAX;
+        uintptr_t high = 0;
+        for (const write_t& write : writes) {
+            if (write.bytes.empty()) {
+                continue;
+            }
+            low = std::min(low, write.address);
+            high = std::max(high, write.address + write.bytes.size());
+            for (uintptr_t page = write.address & ~(pageSize - 1); page < write.address + write.bytes.size(); page += pageSize) {
+                pages.push_back(page);
+            }
+        }
+        std::sort(pages.begin(), pages.end());
+        pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+
+        // Consecutive pages become one run, split where VirtualQuery reports a different protection
+        // so the protection every page had before can be restored exactly
+        typedef struct run_t {
+            uintptr_t base;
+            size_t size;
+            DWORD protect;
+        } run_t;
+        std::vector<run_t> runs;
+        for (size_t i = 0; i < pages.size();) {
+            size_t j = i + 1;
+            while (j < pages.size() && pages[j] == pages[j - 1] + pageSize) {
+                j++;
+            }
+            uintptr_t current = pages[i];
+            uintptr_t end = pages[j - 1] + pageSize;
+            while (current < end) {
+                MEMORY_BASIC_INFORMATION info;
+                if (!VirtualQuery((LPCVOID)current, &info, sizeof(info)) || info.State != MEM_COMMIT) {
+                    return false;
+                }
+                uintptr_t regionEnd = std::min(end, (uintptr_t)info.BaseAddress + info.RegionSize);
+                runs.push_back({ current, regionEnd - current, info.Protect });
+                current = regionEnd;
+            }
+            i = j;
+        }
+
+        size_t unlocked = 0;
+        for (; unlocked < runs.size(); unlocked++) {
+            DWORD oldProtect;
+            if (!VirtualProtect((LPVOID)runs[unlocked].base, runs[unlocked].size, PAGE_EXECUTE_READWRITE, &oldProtect)) {
+                break;
+            }
+        }
+        if (unlocked == runs.size()) {
+            if (restore) {
+                for (auto write = writes.rbegin(); write != writes.rend(); ++write) {
+                    memcpy((void*)write->address, write->original.data(), write->original.size());
+                }
+            }
+            else {
+                for (write_t& write : writes) {
+                    write.original.assign((uint8_t*)write.address, (uint8_t*)write.address + write.bytes.size());
+                    memcpy((void*)write.address, write.bytes.data(), write.bytes.size());
+                }
+            }
+        }
+        for (size_t i = 0; i < unlocked; i++) {
+            DWORD oldProtect;
+            VirtualProtect((LPVOID)runs[i].base, runs[i].size, runs[i].protect, &oldProtect);
+        }
+        if (unlocked != runs.size()) {
+            return false;
+        }
+        if (low < high) {
+            FlushInstructionCache(GetCurrentProcess(), (LPCVOID)low, high - low);
+        }
+        return true;
+    }
+
+    void patternScanScalar(void* module, const char* signature, std::vector<uint64_t>* address)
     {
         static auto pattern_to_byte = [](const char* pattern) {
             std::vector<int> byteArray;
@@ -139,6 +671,255 @@ namespace Utils
         }
     }
 
+    void patternScan(void* module, const pattern_t& pattern, std::vector<uint64_t>* address)
+    {
+        auto dosHeader = (PIMAGE_DOS_HEADER)module;
+        auto ntHeaders = (PIMAGE_NT_HEADERS)((std::uint8_t*)module + dosHeader->e_lfanew);
+
+        auto sizeOfImage = ntHeaders->OptionalHeader.SizeOfImage;
+        auto scanBytes = reinterpret_cast<std::uint8_t*>(module);
+
+        scanRegion(scanBytes, sizeOfImage, pattern, address);
+    }
+
+    void patternScan(const void* data, size_t size, const pattern_t& pattern, std::vector<uint64_t>* address)
+    {
+        scanRegion((const uint8_t*)data, size, pattern, address);
+    }
+
+    void patternScan(void* module, const char* signature, std::vector<uint64_t>* address)
+    {
+        runtimePattern_t pattern;
+        parsePattern(signature, &pattern);
+        patternScan(module, pattern.view, address);
+    }
+
+    std::vector<section_t> getSections(void* module)
+    {
+        auto dosHeader = (PIMAGE_DOS_HEADER)module;
+        auto ntHeaders = (PIMAGE_NT_HEADERS)((std::uint8_t*)module + dosHeader->e_lfanew);
+        auto sectionHeader = IMAGE_FIRST_SECTION(ntHeaders);
+
+        std::vector<section_t> sections;
+        for (WORD i = 0; i < ntHeaders->FileHeader.NumberOfSections; i++, sectionHeader++) {
+            section_t section{};
+            memcpy(section.name, sectionHeader->Name, IMAGE_SIZEOF_SHORT_NAME);
+            section.base = (std::uint8_t*)module + sectionHeader->VirtualAddress;
+            section.size = sectionHeader->Misc.VirtualSize ? sectionHeader->Misc.VirtualSize : sectionHeader->SizeOfRawData;
+            section.characteristics = sectionHeader->Characteristics;
+            sections.push_back(section);
+        }
+        return sections;
+    }
+
+    void patternScan(void* module, const std::vector<signature_t>& signatures, std::vector<std::vector<uint64_t>>* addresses, unsigned threads)
+    {
+        std::vector<multiPattern_t> groups;
+        std::vector<chunk_t> chunks;
+        for (const section_t& section : getSections(module)) {
+            // Only the signatures that expect to live in this section take part in its pass
+            std::vector<pattern_t> patterns;
+            std::vector<size_t> ids;
+            for (size_t i = 0; i < signatures.size(); i++) {
+                bool wanted = signatures[i].section
+                    ? strncmp(section.name, signatures[i].section, IMAGE_SIZEOF_SHORT_NAME) == 0
+                    : (section.characteristics & IMAGE_SCN_MEM_EXECUTE) != 0;
+                if (wanted) {
+                    patterns.push_back(signatures[i].pattern);
+                    ids.push_back(i);
+                }
+            }
+            if (patterns.empty()) {
+                continue;
+            }
+            groups.push_back(buildMultiPattern(patterns, ids));
+            size_t overlap = 0;
+            for (const pattern_t& pattern : groups.back().patterns) {
+                overlap = std::max(overlap, pattern.size);
+            }
+            overlap = overlap ? overlap - 1 : 0;
+            for (auto [base, size] : readableRuns(section.base, section.size)) {
+                splitChunks(groups.size() - 1, base, size, overlap, &chunks);
+            }
+        }
+
+        // Each chunk collects its own hits, concatenating them in chunk order keeps
+        // every signature's hits in ascending address order
+        std::vector<std::vector<std::vector<uint64_t>>> chunkHits(chunks.size());
+        auto scanChunk = [&](size_t k) {
+            const chunk_t& chunk = chunks[k];
+            chunkHits[k].assign(signatures.size(), {});
+            multiScanRegion(chunk.base, chunk.window, groups[chunk.group], &chunkHits[k]);
+            if (chunk.window != chunk.owned) {
+                // Hits starting in the overlap belong to the next chunk
+                uint64_t limit = (uint64_t)(chunk.base + chunk.owned);
+                for (auto& hits : chunkHits[k]) {
+                    hits.erase(std::lower_bound(hits.begin(), hits.end(), limit), hits.end());
+                }
+            }
+        };
+
+        threads = std::clamp(threads, 1u, maxScanThreads);
+        threads = (unsigned)std::min<size_t>(threads, chunks.size());
+        if (threads <= 1) {
+            for (size_t k = 0; k < chunks.size(); k++) {
+                scanChunk(k);
+            }
+        } else {
+            std::atomic<size_t> next = 0;
+            std::vector<std::thread> workers;
+            for (unsigned t = 0; t < threads; t++) {
+                workers.emplace_back([&] {
+                    for (size_t k = next++; k < chunks.size(); k = next++) {
+                        scanChunk(k);
+                    }
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        }
+
+        addresses->assign(signatures.size(), {});
+        for (auto& hits : chunkHits) {
+            for (size_t i = 0; i < signatures.size(); i++) {
+                (*addresses)[i].insert((*addresses)[i].end(), hits[i].begin(), hits[i].end());
+            }
+        }
+    }
+
+    bool patternMatches(void* module, uintptr_t address, const pattern_t& pattern)
+    {
+        auto dosHeader = (PIMAGE_DOS_HEADER)module;
+        auto ntHeaders = (PIMAGE_NT_HEADERS)((std::uint8_t*)module + dosHeader->e_lfanew);
+
+        auto begin = (uintptr_t)module;
+        auto end = begin + ntHeaders->OptionalHeader.SizeOfImage;
+        if (pattern.size == 0 || address < begin || address + pattern.size >= end) {
+            return false;
+        }
+        return matchAt((const uint8_t*)address, pattern);
+    }
+
+    bool patternMatches(void* module, uintptr_t address, const char* signature)
+    {
+        runtimePattern_t pattern;
+        parsePattern(signature, &pattern);
+        return patternMatches(module, address, pattern.view);
+    }
+
+    bool cachedPatternScan(void* module, const std::vector<signature_t>& signatures, std::vector<std::vector<uint64_t>>* addresses, const char* cachePath, unsigned threads)
+    {
+        auto dosHeader = (PIMAGE_DOS_HEADER)module;
+        auto ntHeaders = (PIMAGE_NT_HEADERS)((std::uint8_t*)module + dosHeader->e_lfanew);
+        auto base = (uintptr_t)module;
+
+        std::string fingerprint = std::format("{:08X} {:08X} {:08X}",
+            ntHeaders->FileHeader.TimeDateStamp,
+            ntHeaders->OptionalHeader.CheckSum,
+            ntHeaders->OptionalHeader.SizeOfImage);
+
+        // Cache layout, all numbers in hex:
+        // line 1   : <TimeDateStamp> <CheckSum> <SizeOfImage>
+        // line 2..n: <signature key> <hit count> <rva> <rva> ...
+        std::unordered_map<uint64_t, std::vector<uint64_t>> cached;
+        std::ifstream in(cachePath);
+        std::string line;
+        if (in && std::getline(in, line) && line == fingerprint) {
+            while (std::getline(in, line)) {
+                std::istringstream stream(line);
+                uint64_t key;
+                size_t count;
+                // Every rva takes a space and a digit at least, a larger count is a corrupt line and a miss
+                if (!(stream >> std::hex >> key >> count) || count > line.size() / 2) {
+                    continue;
+                }
+                std::vector<uint64_t> rvas(count);
+                for (auto& rva : rvas) {
+                    stream >> std::hex >> rva;
+                }
+                if (stream) {
+                    cached[key] = std::move(rvas);
+                }
+            }
+        }
+        in.close();
+
+        // Every cached hit must still match, anything else joins one batched rescan
+        addresses->assign(signatures.size(), {});
+        std::vector<signature_t> missing;
+        std::vector<size_t> missingIds;
+        for (size_t i = 0; i < signatures.size(); i++) {
+            auto entry = cached.find(signatureKey(signatures[i]));
+            bool valid = entry != cached.end();
+            if (valid) {
+                for (uint64_t rva : entry->second) {
+                    if (!patternMatches(module, base + (uintptr_t)rva, signatures[i].pattern)) {
+                        valid = false;
+                        break;
+                    }
+                }
+            }
+            if (valid) {
+                for (uint64_t rva : entry->second) {
+                    (*addresses)[i].push_back(base + rva);
+                }
+            } else {
+                missing.push_back(signatures[i]);
+                missingIds.push_back(i);
+            }
+        }
+        if (missing.empty()) {
+            return true;
+        }
+
+        std::vector<std::vector<uint64_t>> found;
+        patternScan(module, missing, &found, threads);
+        for (size_t i = 0; i < missing.size(); i++) {
+            (*addresses)[missingIds[i]] = std::move(found[i]);
+        }
+
+        std::ofstream out(cachePath, std::ios::trunc);
+        out << fingerprint << "\n";
+        for (size_t i = 0; i < signatures.size(); i++) {
+            out << std::format("{:016X} {:X}", signatureKey(signatures[i]), (*addresses)[i].size());
+            for (uint64_t address : (*addresses)[i]) {
+                out << std::format(" {:X}", address - base);
+            }
+            out << "\n";
+        }
+        return false;
+    }
+
+    void** findImport(void* module, const char* dll, const char* function)
+    {
+        auto base = (uint8_t*)module;
+        auto dosHeader = (PIMAGE_DOS_HEADER)base;
+        auto ntHeaders = (PIMAGE_NT_HEADERS)(base + dosHeader->e_lfanew);
+        const IMAGE_DATA_DIRECTORY& directory = ntHeaders->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT];
+        if (directory.VirtualAddress == 0) {
+            return nullptr;
+        }
+        for (auto descriptor = (PIMAGE_IMPORT_DESCRIPTOR)(base + directory.VirtualAddress); descriptor->Name; descriptor++) {
+            if (_stricmp((const char*)(base + descriptor->Name), dll)) {
+                continue;
+            }
+            // Bound or not, the names stay in the original thunks while the slots get overwritten
+            auto names = (PIMAGE_THUNK_DATA)(base + (descriptor->OriginalFirstThunk ? descriptor->OriginalFirstThunk : descriptor->FirstThunk));
+            auto slots = (PIMAGE_THUNK_DATA)(base + descriptor->FirstThunk);
+            for (; names->u1.AddressOfData; names++, slots++) {
+                if (IMAGE_SNAP_BY_ORDINAL(names->u1.Ordinal)) {
+                    continue;
+                }
+                auto byName = (PIMAGE_IMPORT_BY_NAME)(base + names->u1.AddressOfData);
+                if (!strcmp((const char*)byName->Name, function)) {
+                    return (void**)&slots->u1.Function;
+                }
+            }
+        }
+        return nullptr;
+    }
+
     DWORD findProcessID(const char* targetProcess)
     {
         DWORD processId = 0;
@@ -159,4 +940,69 @@ namespace Utils
         }
         return processId;
     }
+
+    bool suspendAllThreads(const std::vector<codeRange_t>& avoid)
+    {
+        DWORD processId = GetCurrentProcessId();
+        DWORD currentId = GetCurrentThreadId();
+        std::vector<DWORD> suspendedIds;
+        bool ok = true;
+
+        HANDLE heap = GetProcessHeap();
+        HeapLock(heap);
+        for (bool found = true; found && ok;) {
+            found = false;
+            HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+            if (snapshot == INVALID_HANDLE_VALUE) {
+                ok = false;
+                break;
+            }
+            THREADENTRY32 threadEntry;
+            threadEntry.dwSize = sizeof(threadEntry);
+            for (BOOL more = Thread32First(snapshot, &threadEntry); more; more = Thread32Next(snapshot, &threadEntry)) {
+                if (threadEntry.th32OwnerProcessID != processId || threadEntry.th32ThreadID == currentId
+                    || std::find(suspendedIds.begin(), suspendedIds.end(), threadEntry.th32ThreadID) != suspendedIds.end()) {
+                    continue;
+                }
+                HANDLE thread = OpenThread(THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_QUERY_INFORMATION, FALSE, threadEntry.th32ThreadID);
+                if (!thread) {
+                    // Exited since the snapshot
+                    continue;
+                }
+                if (SuspendThread(thread) == (DWORD)-1) {
+                    CloseHandle(thread);
+                    continue;
+                }
+                int retries = 0;
+                while (insideRange(thread, avoid) && retries++ < maxRangeRetries) {
+                    ResumeThread(thread);
+                    SwitchToThread();
+                    SuspendThread(thread);
+                }
+                suspendedThreads.push_back(thread);
+                suspendedIds.push_back(threadEntry.th32ThreadID);
+                found = true;
+                if (retries > maxRangeRetries) {
+                    ok = false;
+                    break;
+                }
+            }
+            CloseHandle(snapshot);
+        }
+        HeapUnlock(heap);
+
+        if (!ok) {
+            resumeAllThreads();
+        }
+        return ok;
+    }
+
+    void resumeAllThreads()
+    {
+        for (HANDLE thread : suspendedThreads) {
+            ResumeThread(thread);
+            CloseHandle(thread);
+        }
+        suspendedThreads.clear();
+    }
 }
@@ -0,0 +1,100 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Dominik Protasewicz
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <Windows.h>
+#include <string>
+
+#include "watcher.hpp"
+
+namespace
+{
+    typedef struct watch_t {
+        HANDLE directory;
+        std::wstring file;
+        Watcher::changed_t changed;
+    } watch_t;
+
+    bool matches(const FILE_NOTIFY_INFORMATION* info, const std::wstring& file) {
+        size_t length = info->FileNameLength / sizeof(WCHAR);
+        return length == file.size() && CompareStringOrdinal(info->FileName, (int)length, file.c_str(), (int)file.size(), TRUE) == CSTR_EQUAL;
+    }
+
+    DWORD WINAPI watch(void* parameter) {
+        auto watch = (watch_t*)parameter;
+        alignas(DWORD) uint8_t buffer[4096];
+        while (true) {
+            DWORD bytes = 0;
+            if (!ReadDirectoryChangesW(watch->directory, buffer, sizeof(buffer), FALSE,
+                    FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE,
+                    &bytes, NULL, NULL)) {
+                break;
+            }
+            // No bytes means the changes overflowed the buffer, the file may be among them
+            bool hit = bytes == 0;
+            for (DWORD offset = 0; !hit && offset < bytes;) {
+                auto info = (const FILE_NOTIFY_INFORMATION*)(buffer + offset);
+                hit = info->Action != FILE_ACTION_REMOVED && info->Action != FILE_ACTION_RENAMED_OLD_NAME && matches(info, watch->file);
+                if (info->NextEntryOffset == 0) {
+                    break;
+                }
+                offset += info->NextEntryOffset;
+            }
+            if (hit) {
+                Sleep(Watcher::settleMs);
+                watch->changed();
+            }
+        }
+        CloseHandle(watch->directory);
+        delete watch;
+        return 0;
+    }
+}
+
+namespace Watcher
+{
+    bool start(const char* directory, const char* file, changed_t changed) {
+        HANDLE handle = CreateFileA(directory, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+        if (handle == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        int length = MultiByteToWideChar(CP_ACP, 0, file, -1, NULL, 0);
+        std::wstring wide(length > 0 ? length - 1 : 0, L'\0');
+        if (length > 1) {
+            MultiByteToWideChar(CP_ACP, 0, file, -1, wide.data(), length);
+        }
+
+        auto state = new watch_t{ handle, wide, changed };
+        HANDLE thread = CreateThread(NULL, 0, watch, state, CREATE_SUSPENDED, NULL);
+        if (!thread) {
+            CloseHandle(handle);
+            delete state;
+            return false;
+        }
+        SetThreadPriority(thread, THREAD_PRIORITY_LOWEST);
+        ResumeThread(thread);
+        CloseHandle(thread);
+        return true;
+    }
+}